@@ -1,89 +1,53 @@
-let step = '';
-const lanes = document.querySelectorAll('.lane');
-
-
-let aR = '';
-let bR = '';
-let cR = '';
-
-
-lanes[0].style.border = aR;
-lanes[1].style.border = bR;
-lanes[2].style.border = cR;
-
-
-async function updateDashboard() {
-  try {
-    const res = await fetch("/status");
-    const data = await res.json();
-
-    // update body attribute
-    step =  data.currentStep;
-
-    // update stats
-async function updateDashboard() {
-  try {
-    const res = await fetch("/status");
-    const data = await res.json();
-
-    // update body attribute
-    document.body.dataset.step = data.currentStep;
-
-    // update per-lane stats
-    const lanes = document.querySelectorAll(".lane");
-    data.lanes.forEach((laneData, i) => {
-      if (lanes[i]) {
-        lanes[i].querySelector("p:nth-child(2) span").textContent = laneData.count;
-        lanes[i].querySelector("p:nth-child(3) span").textContent = laneData.flow;
-        lanes[i].querySelector("p:nth-child(4) span").textContent = laneData.speed;
-      }
-    });
-
-  } catch (e) {
-    console.error("Failed to update dashboard:", e);
+// Dashboard state, in the shape of /api/status. /api/events sends the full
+// document once, then only the parts that change; each is merged in here.
+const state = { status: {}, lanes: {} };
+const laneDivs = document.querySelectorAll(".lane");
+const borders = { red: "3px solid red", yellow: "3px solid yellow", green: "3px solid green" };
+
+function merge(update) {
+  if (update.status) Object.assign(state.status, update.status);
+  if (update.lanes) {
+    for (const [name, lane] of Object.entries(update.lanes)) state.lanes[name] = lane;
   }
 }
 
+function render() {
+  document.body.dataset.step = state.status.currentStep;
+  Object.keys(state.lanes).sort().forEach((name, i) => {
+    const div = laneDivs[i];
+    const lane = state.lanes[name];
+    if (!div) return;
+    div.querySelector("h2").textContent = "Lane " + name.slice(4);
+    div.querySelector("p:nth-of-type(1) span").textContent = lane.greenTime;
+    div.querySelector("p:nth-of-type(2) span").textContent = lane.count;
+    div.querySelector("p:nth-of-type(3) span").textContent = (lane.flow * 3600).toFixed(0) + " veh/h";
+    div.querySelector("p:nth-of-type(4) span").textContent = lane.avgSpeed.toFixed(1) + " m/s";
+    div.style.border = borders[lane.status] || "";
+  });
+}
+
+// Fallback for browsers without EventSource
+async function poll() {
+  try {
+    const res = await fetch("/api/status");
+    merge(await res.json());
+    render();
   } catch (e) {
     console.error("Failed to update dashboard:", e);
   }
 }
 
-// run every 100ms
-setInterval(updateDashboard, 100);
-
-
-switch (step) {
-    case "0":
-        aR = '3px solid yellow';
-        bR = '3px solid red';
-        cR = '3px solid red';
-        break;
-    case "1":
-        aR = '3px solid yellow';
-        bR = '3px solid yellow';
-        cR = '3px solid red';
-        break;
-    case "2":
-        aR = '3px solid red';
-        bR = '3px solid green';
-        cR = '3px solid red';
-        break;
-    case "3":
-        aR = '3px solid red';
-        bR = '3px solid yellow';
-        cR = '3px solid yellow';
-        break;
-    case "4":
-        aR = '3px solid red';
-        bR = '3px solid red';
-        cR = '3px solid green';
-        break;
-    case "5":
-        aR = '3px solid red';
-        bR = '3px solid yellow';
-        cR = '3px solid yellow';
-        break;
-
+if (window.EventSource) {
+  // Reconnects by itself; the first frame after a reconnect is a full document
+  const events = new EventSource("/api/events");
+  events.onmessage = (e) => {
+    merge(JSON.parse(e.data));
+    render();
+  };
+} else {
+  setInterval(poll, 1000);
 }
 
+document.querySelector("button").addEventListener("click", () => {
+  fetch("/api/toggleAllRed", { method: "POST" });
+});
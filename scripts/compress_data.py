@@ -0,0 +1,35 @@
+# PlatformIO pre-script: before a filesystem image is built, writes a gzip
+# copy next to every asset in data/ that compresses, so the web server can
+# send it as-is to clients that accept gzip (src/StaticFiles.cpp). The
+# originals stay for clients that don't. Copies are rebuilt when stale.
+Import("env")
+
+import gzip
+import os
+
+FS_TARGETS = {"buildfs", "uploadfs", "uploadfsota"}
+
+
+def compress_data(data_dir):
+    for root, _, files in os.walk(data_dir):
+        for name in files:
+            if name.endswith(".gz"):
+                continue
+            src = os.path.join(root, name)
+            dst = src + ".gz"
+            if os.path.exists(dst) and os.path.getmtime(dst) >= os.path.getmtime(src):
+                continue
+            with open(src, "rb") as f:
+                raw = f.read()
+            packed = gzip.compress(raw, compresslevel=9, mtime=0)
+            if len(packed) >= len(raw):
+                if os.path.exists(dst):
+                    os.remove(dst)
+                continue
+            with open(dst, "wb") as f:
+                f.write(packed)
+            print("compress_data: %s %d -> %d bytes" % (os.path.relpath(src, data_dir), len(raw), len(packed)))
+
+
+if FS_TARGETS & set(COMMAND_LINE_TARGETS):
+    compress_data(env.subst("$PROJECT_DATA_DIR"))
@@ -1,19 +1,13 @@
 #include <Arduino.h>
+#include <math.h>
 #include "Adaptive.h"
 
-// Keep smoothed values static so they persist across calls
-static float smoothedFlow = 0;
-static float smoothedSpeed = 0;
-static bool initialized = false;
+void AdaptiveGreen::reset() {
+  smoothedFlow = smoothedSpeed = integral = 0;
+  initialized = false;
+}
 
-unsigned long adjustGreen(unsigned long currentGreen,
-                          float flow,
-                          float speed,
-                          float Kp,
-                          float s_target,
-                          float deltamax,
-                          unsigned long minGreen,
-                          unsigned long maxGreen) {
+unsigned long AdaptiveGreen::update(unsigned long currentGreen, float flow, float speed) {
   const float alpha = 0.3; // smoothing factor (0.1=very smooth, 0.5=fast response)
 
   // Initialize EMA on first call
@@ -28,10 +22,19 @@ unsigned long adjustGreen(unsigned long currentGreen,
 
   // Use smoothed values
   float s = smoothedFlow / (smoothedSpeed > 0 ? smoothedSpeed : 1);
-  float delta = Kp * (s - s_target);
+  float error = s - params.s_target;
+  float candidate = integral + params.Ki * error;
+  float delta = params.Kp * error + candidate;
 
-  if (delta > deltamax) delta = deltamax;
-  if (delta < -deltamax) delta = -deltamax;
+  // Rate limit, then the green bounds; `saturated` is the side the output is pinned to
+  int saturated = 0;
+  if (delta > params.deltamax) { delta = params.deltamax; saturated = 1; }
+  if (delta < -params.deltamax) { delta = -params.deltamax; saturated = -1; }
+  long next = (long)currentGreen + lroundf(delta);
+  if (next < (long)params.minGreen) { next = params.minGreen; saturated = -1; }
+  if (next > (long)params.maxGreen) { next = params.maxGreen; saturated = 1; }
 
-  return constrain(currentGreen + (long)delta, minGreen, maxGreen);
+  // Anti-windup: integrate unless that would push further into the limit
+  if (saturated == 0 || (error > 0) != (saturated > 0)) integral = candidate;
+  return next;
 }
@@ -1,3 +1,31 @@
 #pragma once
 
-unsigned long adjustGreen(unsigned long currentGreen, float flow, float speed, float Kp, float s_target, float deltamax, unsigned long minGreen, unsigned long maxGreen);
+// Gains and bounds for one AdaptiveGreen
+struct AdaptiveParams {
+  float Kp, Ki;       // s of green per unit of flow/speed error (Ki: per update)
+  float s_target;     // flow/speed ratio the lane is steered towards
+  float deltamax;     // largest change of green per update, s
+  unsigned long minGreen, maxGreen;
+};
+
+// Per-lane feedback trim of a green time from the lane's smoothed flow/speed
+// ratio: proportional plus integral term, the integral held while the output
+// is rate-limited or on a green bound (anti-windup), and every change limited
+// to +-deltamax. All state lives in the object, so each lane owns one and
+// instances can be updated side by side.
+class AdaptiveGreen {
+ public:
+  AdaptiveGreen() : params() {}
+  explicit AdaptiveGreen(const AdaptiveParams &params) : params(params) {}
+
+  unsigned long update(unsigned long currentGreen, float flow, float speed);
+  void reset();
+
+  AdaptiveParams params;
+
+ private:
+  float smoothedFlow = 0;
+  float smoothedSpeed = 0;
+  float integral = 0;
+  bool initialized = false;
+};
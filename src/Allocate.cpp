@@ -0,0 +1,77 @@
+#include "Allocate.h"
+#include <algorithm>
+#include <math.h>
+
+struct Breakpoint {
+  double level;
+  double slope;  // change in d(sum)/dL past this point
+  double fixed;  // change in the clamped lanes' constant part
+  bool operator<(const Breakpoint &o) const { return level < o.level; }
+};
+
+bool allocateGreens(const float *weight, size_t n, unsigned long budget,
+                    unsigned long lo, unsigned long hi, unsigned long *out) {
+  if (n == 0 || n > maxAllocLanes || lo > hi) return false;
+  if (n * lo >= budget || n * hi <= budget) {
+    unsigned long v = (n * lo >= budget) ? lo : hi;
+    for (size_t i = 0; i < n; i++) out[i] = v;
+    return n * v == budget;
+  }
+
+  // Zero weights become a tiny positive weight so those lanes fill last
+  double w[maxAllocLanes];
+  double maxW = 0;
+  for (size_t i = 0; i < n; i++) {
+    w[i] = (weight[i] > 0 && isfinite(weight[i])) ? weight[i] : 0;
+    maxW = std::max(maxW, w[i]);
+  }
+  double floorW = (maxW > 0) ? maxW * 1e-6 : 1;
+  for (size_t i = 0; i < n; i++) w[i] = std::max(w[i], floorW);
+
+  // sum(L) is piecewise linear: lane i is lo up to lo/w, then L*w, then hi past hi/w
+  Breakpoint bp[2 * maxAllocLanes];
+  for (size_t i = 0; i < n; i++) {
+    bp[2 * i] = Breakpoint{lo / w[i], w[i], -(double)lo};
+    bp[2 * i + 1] = Breakpoint{hi / w[i], -w[i], (double)hi};
+  }
+  std::sort(bp, bp + 2 * n);
+
+  double fixed = (double)n * lo, slope = 0;
+  for (size_t k = 0; k < 2 * n; k++) {
+    if (slope > 0 && fixed + slope * bp[k].level >= budget) break;
+    fixed += bp[k].fixed;
+    slope += bp[k].slope;
+  }
+  double level = (slope > 0) ? (budget - fixed) / slope : 0;
+
+  // Largest-remainder rounding to whole seconds
+  double rem[maxAllocLanes];
+  size_t order[maxAllocLanes];
+  long assigned = 0;
+  for (size_t i = 0; i < n; i++) {
+    double x = std::min((double)hi, std::max((double)lo, level * w[i]));
+    out[i] = (unsigned long)floor(x);
+    rem[i] = x - out[i];
+    assigned += out[i];
+    order[i] = i;
+  }
+  std::stable_sort(order, order + n, [&](size_t a, size_t b) { return rem[a] > rem[b]; });
+
+  // Rounding error leaves |budget - assigned| < n; the loops only ever step
+  // lanes that stay within [lo, hi]
+  long left = (long)budget - assigned;
+  for (size_t k = 0; left > 0; k = (k + 1) % n)
+    if (out[order[k]] < hi) { out[order[k]]++; left--; }
+  for (size_t k = n - 1; left < 0; k = (k + n - 1) % n)
+    if (out[order[k]] > lo) { out[order[k]]--; left++; }
+  return true;
+}
+
+unsigned long websterCycle(float lostTime, float flowRatio, unsigned long minCycle, unsigned long maxCycle) {
+  if (!(flowRatio < 0.95f)) return maxCycle;  // also catches NaN
+  if (flowRatio < 0) flowRatio = 0;
+  float c = (1.5f * lostTime + 5) / (1 - flowRatio);
+  if (c <= minCycle) return minCycle;
+  if (c >= maxCycle) return maxCycle;
+  return (unsigned long)(c + 0.5f);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <stddef.h>
+
+// Most lanes allocateGreens() handles in one call
+const size_t maxAllocLanes = 16;
+
+// Exact bounded proportional split ("water-filling"): finds the level L with
+// sum(clamp(L * weight[i], lo, hi)) == budget in one sort-and-sweep over the
+// 2n clamp breakpoints, then rounds to whole seconds by largest remainder (ties
+// to the lower index) so out[] sums to budget exactly. Zero-weight lanes only
+// rise above lo once every weighted lane is at hi. If n*lo > budget or
+// n*hi < budget no split fits; every lane gets the binding bound and false is
+// returned.
+bool allocateGreens(const float *weight, size_t n, unsigned long budget,
+                    unsigned long lo, unsigned long hi, unsigned long *out);
+
+// Webster's optimum cycle, (1.5 L + 5) / (1 - Y), for lostTime L (s) and the
+// sum Y of critical flow ratios (flow / saturation flow) of the phases; clamped
+// to [minCycle, maxCycle], and to maxCycle once Y nears 1.
+unsigned long websterCycle(float lostTime, float flowRatio, unsigned long minCycle, unsigned long maxCycle);
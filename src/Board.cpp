@@ -0,0 +1,84 @@
+#include "Board.h"
+#include "interface.h"
+#include "Telemetry.h"
+#include "EventLog.h"
+#include "EchoTrace.h"
+#include "Metrics.h"
+#include "Log.h"
+
+// Event log entries for new vehicles, step changes, preemption phases and each closed cycle
+static void logEvents(const SensorFrame &frame, const TrafficStatus &st) {
+  static SensorTotals last[APPROACHES];
+  static int lastStep = -1;
+  static bool lastAllRed = false;
+  static PreemptPhase lastPreempt = PREEMPT_NONE;
+
+  for (int i = 0; i < APPROACHES; i++) {
+    const SensorTotals &t = frame.lanes[i];
+    if (t.vehicles != last[i].vehicles) {
+      unsigned long speeds = t.speedCount - last[i].speedCount;
+      float speed = speeds ? (t.totalSpeed - last[i].totalSpeed) / speeds : 0;
+      eventLog(LOG_DETECTION, i, (uint16_t)(speed * 100 + 0.5f), (uint16_t)t.vehicles,
+               st.lanes[i].aspect == ASPECT_GREEN);
+    }
+    last[i] = t;
+  }
+
+  if (st.preempt != lastPreempt) {
+    unsigned long latency = st.preempt == PREEMPT_SERVE ? st.preemptLatency : 0;
+    eventLog(LOG_PREEMPT, (uint8_t)st.priorityLane, st.preempt, (uint16_t)min(latency, 0xffffUL), st.priorityPending);
+    lastPreempt = st.preempt;
+  }
+
+  if (st.currentStep == lastStep && st.allRed == lastAllRed) return;
+  if (st.currentStep == 0 && lastStep > 0)
+    for (int i = 0; i < APPROACHES; i++) {
+      const LaneSummary &L = st.lanes[i];
+      eventLog(LOG_CYCLE, i, L.count, (uint16_t)(L.flow * 3600 + 0.5f), (uint16_t)(L.avgSpeed * 100 + 0.5f), L.green);
+    }
+  eventLog(LOG_STEP, 0, st.currentStep, st.cycle, st.allRed);
+  lastStep = st.currentStep;
+  lastAllRed = st.allRed;
+}
+
+class BoardHooks : public TaskHooks {
+ public:
+  void attachSensors(UltrasonicState *sensors, int count) override {
+    for (int i = 0; i < count; i++) {
+      sensors[i].tap = traceTap;
+      sensors[i].tapCtx = (void *)(uintptr_t)i;
+    }
+  }
+
+  // A trace replay stands in for the live echoes
+  bool replaying(UltrasonicState *sensors, const char *const *names, int count) override {
+    return traceReplaying(sensors, names, count);
+  }
+
+  void controlled(const SensorFrame &frame, const TrafficStatus &status) override { logEvents(frame, status); }
+
+  // A slow request or flash write here never delays the lights
+  void serviceNetwork() override {
+    {
+      MetricScope timing(METRIC_WEB);
+      handleWebServer();
+    }
+    telemetryFlush();
+    eventLogFlush();
+    traceFlush();
+  }
+
+  void publish(const TrafficStatus &status) override {
+    updateTrafficStatus(status);
+    for (int i = 0; i < APPROACHES; i++) updateLaneData(i, status.lanes[i]);
+  }
+
+  void drainLog() override { logFlush(); }
+
+  CoordLink *coordinationLink() override { return ::coordinationLink(); }
+};
+
+TaskHooks &boardHooks() {
+  static BoardHooks hooks;
+  return hooks;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include "Tasks.h"
+
+// The firmware's task hooks: web server and cloud pushes, event log, echo
+// traces and the serial log drain, and corridor datagrams over UDP
+TaskHooks &boardHooks();
@@ -0,0 +1,55 @@
+#pragma once
+#include <stdint.h>
+
+// Corridor coordination datagrams (Coordination.h), sent over UDP between the
+// controllers of one corridor. Every datagram starts with a CoordHeader.
+// Fields are little-endian, laid out without padding (checked below). A
+// receiver drops datagrams with another magic, version or corridor.
+
+static const uint16_t coordMagic = 0x4f43;  // "CO"
+static const uint8_t coordVersion = 2;
+static const uint16_t coordPort = 47702;
+
+enum CoordType : uint8_t {
+  COORD_SYNC,        // clock request to node 0: t1
+  COORD_SYNC_REPLY,  // t1 echoed, t2 / t3, the cycle and its epoch on node 0's clock
+  COORD_STATE,       // cycle and phase state, to the neighbours
+};
+
+enum CoordFlag : uint8_t {
+  COORD_SYNCED = 1,  // sender's clock follows node 0
+};
+
+struct CoordHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t type;      // CoordType
+  uint8_t corridor;  // controllers of other corridors on the same network ignore it
+  uint8_t from;      // node, numbered in travel direction
+  uint8_t to;
+  uint8_t reserved;
+};
+
+// Times in ms
+struct CoordSync {
+  CoordHeader h;
+  uint32_t t1;       // requester's clock at send
+  uint32_t t2;       // node 0's clock at receive (reply)
+  uint32_t t3;       // node 0's clock at reply
+  uint32_t cycleMs;  // corridor cycle (reply)
+  uint32_t epochMs;  // node 0's clock: a recent corridor cycle start (reply)
+};
+
+struct CoordState {
+  CoordHeader h;
+  uint32_t cycleMs;
+  uint32_t offsetMs;  // coordinated green starts this far into the cycle
+  uint32_t greenAt;   // corridor clock: coordinated green last lit
+  uint16_t green;     // s, planned coordinated green
+  uint8_t flags;      // CoordFlag
+  uint8_t reserved;
+};
+
+static_assert(sizeof(CoordHeader) == 8, "coordination header layout");
+static_assert(sizeof(CoordSync) == 28, "coordination sync layout");
+static_assert(sizeof(CoordState) == 24, "coordination state layout");
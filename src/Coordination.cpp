@@ -0,0 +1,258 @@
+#include "Coordination.h"
+#include <string.h>
+
+static const uint32_t syncInterval = 1000;   // ms
+static const uint32_t stateInterval = 1000;  // ms
+static const float profileDecay = 0.9f;      // per cycle
+static const float minArrivals = 10;         // profile weight before the offset moves
+static const float adaptMargin = 0.02f;      // of the profile weight a move has to gain
+static const int greenLead = 2;              // s, start-up loss: arrivals this early in a green still stop
+
+void Coordinator::begin(const CoordConfig &c, CoordLink *l, uint32_t now) {
+  config = c;
+  link = c.nodes > 1 ? l : nullptr;
+  synced = link && c.node == 0;
+  clockOffset = 0;
+  roundTrip = 0;
+  sampleCount = sampleNext = 0;
+  lastSyncSent = now - syncInterval;
+  lastState = now - stateInterval;
+  lastSyncReply = lastAdapt = now;
+  cycleMs = offsetMs = 0;
+  epochMs = now;
+  setCycle(c.cycle * 1000);
+  offsetMs = cycleMs ? c.offset * 1000 % cycleMs : 0;
+  lastPosition = position(now);
+  greenAt = 0;
+  green = 0;
+  up = down = CoordNeighbor();
+  shifts = 0;
+}
+
+// ms into the cycle started `offset` after the epoch's. The difference to
+// the epoch is taken signed, so it holds across the wrap and for times just
+// before the epoch.
+uint32_t Coordinator::phase(uint32_t now, uint32_t offset) const {
+  if (!cycleMs) return 0;
+  int64_t t = (int32_t)(corridor(now) - epochMs - offset) % (int64_t)cycleMs;
+  return (uint32_t)(t < 0 ? t + cycleMs : t);
+}
+
+// A new cycle length invalidates the arrival profile
+void Coordinator::setCycle(uint32_t ms) {
+  if (ms > (uint32_t)maxCycle * 1000) ms = maxCycle * 1000;
+  if (ms == cycleMs) return;
+  cycleMs = ms;
+  if (cycleMs) offsetMs %= cycleMs;
+  clearProfile();
+}
+
+void Coordinator::clearProfile() {
+  memset(profile, 0, sizeof(profile));
+  profileTotal = 0;
+}
+
+void Coordinator::header(CoordHeader &h, CoordType type, uint8_t to) const {
+  h = CoordHeader{coordMagic, coordVersion, type, config.corridor, config.node, to, 0};
+}
+
+void Coordinator::sendState(uint8_t to) {
+  CoordState s;
+  header(s.h, COORD_STATE, to);
+  s.cycleMs = cycleMs;
+  s.offsetMs = offsetMs;
+  s.greenAt = greenAt;
+  s.green = green;
+  s.flags = synced ? COORD_SYNCED : 0;
+  s.reserved = 0;
+  link->send(to, &s, sizeof(s));
+}
+
+void Coordinator::service(uint32_t now) {
+  if (!link) return;
+  receive(now);
+
+  // Keep the epoch within a cycle of now, well inside the signed range
+  uint32_t since = corridor(now) - epochMs;
+  if (cycleMs && (int32_t)since >= (int32_t)cycleMs) epochMs += since / cycleMs * cycleMs;
+
+  if (config.node != 0 && now - lastSyncSent >= syncInterval) {
+    lastSyncSent = now;
+    CoordSync s = {};
+    header(s.h, COORD_SYNC, 0);
+    s.t1 = now;
+    link->send(0, &s, sizeof(s));
+  }
+  if (synced && now - lastState >= stateInterval) {
+    lastState = now;
+    if (config.node > 0) sendState(config.node - 1);
+    if (config.node + 1 < config.nodes) sendState(config.node + 1);
+  }
+
+  // Once per cycle, as the position wraps. A move of the offset shifts the
+  // position too, hence the time guard.
+  uint32_t pos = position(now);
+  if (synced && pos < lastPosition && now - lastAdapt > cycleMs / 2) {
+    lastAdapt = now;
+    adapt();
+    pos = position(now);
+  }
+  lastPosition = pos;
+}
+
+void Coordinator::receive(uint32_t now) {
+  union {
+    CoordHeader h;
+    CoordSync sync;
+    CoordState state;
+  } m;
+  size_t n;
+  while ((n = link->receive(&m, sizeof(m))) > 0) {
+    const CoordHeader &h = m.h;
+    if (n < sizeof(h) || h.magic != coordMagic || h.version != coordVersion || h.corridor != config.corridor ||
+        h.to != config.node || h.from == config.node || h.from >= config.nodes)
+      continue;
+
+    if (h.type == COORD_SYNC && n >= sizeof(CoordSync) && config.node == 0) {
+      CoordSync r = m.sync;
+      uint8_t to = h.from;
+      header(r.h, COORD_SYNC_REPLY, to);
+      r.t2 = r.t3 = now;  // node 0's clock is the corridor clock
+      r.cycleMs = cycleMs;
+      r.epochMs = epochMs;
+      link->send(to, &r, sizeof(r));
+    } else if (h.type == COORD_SYNC_REPLY && n >= sizeof(CoordSync) && h.from == 0) {
+      // Offset mod 2^32: forward difference plus half the (small, signed)
+      // asymmetry, so clocks any distance apart don't overflow
+      const CoordSync &s = m.sync;
+      uint32_t forward = s.t2 - s.t1, back = s.t3 - now;
+      SyncSample &x = samples[sampleNext];
+      x.offset = (int32_t)(forward + (uint32_t)((int32_t)(back - forward) / 2));
+      x.roundTrip = (now - s.t1) - (s.t3 - s.t2);
+      sampleNext = (sampleNext + 1) % syncSamples;
+      if (sampleCount < syncSamples) sampleCount++;
+
+      const SyncSample *best = &samples[0];
+      for (int i = 1; i < sampleCount; i++)
+        if (samples[i].roundTrip < best->roundTrip) best = &samples[i];
+      clockOffset = best->offset;
+      roundTrip = best->roundTrip;
+      synced = true;
+      lastSyncReply = now;
+      setCycle(s.cycleMs);
+      epochMs = s.epochMs;
+    } else if (h.type == COORD_STATE && n >= sizeof(CoordState)) {
+      const CoordState &s = m.state;
+      bool upstream = h.from + 1 == config.node;
+      if (!upstream && h.from != config.node + 1) continue;
+      CoordNeighbor &nb = upstream ? up : down;
+      // Arrivals are timed from the upstream cycle start: follow it when it moves
+      if (upstream && up.seen) {
+        if (s.cycleMs != up.cycleMs) clearProfile();
+        else if (cycleMs && s.cycleMs == cycleMs && s.offsetMs != up.offsetMs)
+          rotate((s.offsetMs + cycleMs - up.offsetMs) % cycleMs);
+      }
+      nb = CoordNeighbor{true, now, s.cycleMs, s.offsetMs, s.greenAt, s.green, s.flags};
+    }
+  }
+}
+
+// The upstream offset moved by `byMs`: an arrival that was t after the old
+// cycle start is t - byMs after the new one
+void Coordinator::rotate(uint32_t byMs) {
+  int n = bins(), by = (byMs + 500) / 1000 % n;
+  if (!by) return;
+  float old[maxCycle];
+  memcpy(old, profile, sizeof(old));
+  for (int b = 0; b < n; b++) profile[b] = old[(b + by) % n];
+}
+
+void Coordinator::onArrival(uint32_t at) {
+  if (!synced || !up.seen || !cycleMs || up.cycleMs != cycleMs) return;
+  profile[phase(at, up.offsetMs) / 1000] += 1;
+  profileTotal += 1;
+}
+
+void Coordinator::onGreen(uint32_t at, unsigned long g) {
+  greenAt = corridor(at);
+  green = g;
+}
+
+// Profile weight in seconds [from, to) of a green starting `start` s after
+// the upstream cycle start
+float Coordinator::score(int start, int from, int to) const {
+  int n = bins();
+  if (to > n) to = n;
+  float sum = 0;
+  for (int k = from; k < to; k++) sum += profile[(start + k) % n];
+  return sum;
+}
+
+// Once per cycle: age the profile, then step the offset towards the green
+// start that catches the most arrivals past the start-up loss. Among equally
+// good starts the nearest wins, so a green longer than the platoon stays put.
+void Coordinator::adapt() {
+  int n = bins();
+  profileTotal = 0;
+  for (int b = 0; b < n; b++) {
+    profile[b] *= profileDecay;
+    profileTotal += profile[b];
+  }
+  if (!config.adapt || config.node == 0 || !up.seen || up.cycleMs != cycleMs || profileTotal < minArrivals ||
+      green <= (unsigned long)greenLead)
+    return;
+
+  int current = ((offsetMs + cycleMs - up.offsetMs) % cycleMs + 500) / 1000 % n;
+  float stay = score(current, greenLead, green), bestScore = stay;
+  int best = current, bestDistance = 0;
+  for (int d = 0; d < n; d++) {
+    float s = score(d, greenLead, green);
+    int distance = d > current ? d - current : current - d;
+    if (distance > n / 2) distance = n - distance;
+    if (s > bestScore + 1e-3f || (s > bestScore - 1e-3f && distance < bestDistance)) {
+      best = d;
+      bestScore = s;
+      bestDistance = distance;
+    }
+  }
+  if (bestScore < stay + adaptMargin * profileTotal) return;
+
+  int move = best - current;
+  if (move > n / 2) move -= n;
+  if (move < -n / 2) move += n;
+  if (move > adaptStep) move = adaptStep;
+  if (move < -adaptStep) move = -adaptStep;
+  offsetMs = (uint32_t)(((int64_t)offsetMs + cycleMs + move * 1000) % cycleMs);
+  shifts++;
+}
+
+CoordPlan Coordinator::plan(uint32_t now) const {
+  CoordPlan p;
+  p.active = synced && cycleMs > 0;
+  p.lane = config.lane;
+  p.cycleMs = cycleMs;
+  p.zeroAt = now - position(now);
+  return p;
+}
+
+CoordStatus Coordinator::status(uint32_t now) const {
+  CoordStatus s;
+  s.active = synced && cycleMs > 0;
+  s.synced = synced;
+  s.clockOffset = clockOffset;
+  s.roundTrip = roundTrip;
+  s.syncAge = config.node && synced ? now - lastSyncReply : 0;
+  s.cycleMs = cycleMs;
+  s.offsetMs = offsetMs;
+  s.position = position(now);
+  s.arrivals = profileTotal;
+  s.onGreen = 0;
+  if (profileTotal > 0 && up.seen && up.cycleMs == cycleMs && cycleMs) {
+    int current = ((offsetMs + cycleMs - up.offsetMs) % cycleMs + 500) / 1000 % bins();
+    s.onGreen = score(current, 0, green) / profileTotal;
+  }
+  s.shifts = shifts;
+  s.upstream = up;
+  s.downstream = down;
+  return s;
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "CoordFormat.h"
+
+// Corridor coordination. The controllers along a road share one cycle length,
+// and each lights its coordinated green at its own offset into that cycle, so
+// a platoon released by one green reaches the next intersection on green.
+// Nodes are numbered in travel direction; node n - 1 is upstream of node n.
+//
+// Clock: node 0 keeps the corridor clock. Every other node sends it a
+// COORD_SYNC each second and takes the offset ((t2 - t1) + (t3 - t4)) / 2 of
+// the exchange with the shortest round trip among its last syncSamples, which
+// leaves out most queueing delay. Node 0's cycle comes back with every reply,
+// together with its epoch: the corridor time of a recent cycle start. Every
+// node times the cycle from that epoch and moves it on by whole cycles, so
+// the phase runs on through the millis() wrap instead of jumping there.
+//
+// State: each node sends its cycle, offset and coordinated green to its
+// neighbours each second.
+//
+// Offsets: with `adapt`, a node keeps a 1 s-bin profile of arrivals on its
+// coordinated approach, timed from the upstream node's cycle start. Once per
+// cycle it moves its offset by at most adaptStep s towards the offset that
+// puts the most of those arrivals on its green.
+//
+// A node that has never synced runs free (Webster cycle, no offset). One that
+// loses node 0 keeps its last clock offset.
+
+struct CoordConfig {
+  uint8_t corridor;
+  uint8_t node;          // place along the corridor, in travel direction; node 0 keeps the clock
+  uint8_t nodes;         // < 2: no coordination
+  uint8_t lane;          // coordinated approach, the one traffic from the upstream node arrives on
+  unsigned long cycle;   // s, common cycle; node 0's is used by all
+  unsigned long offset;  // s, coordinated green start into the cycle, to begin with
+  bool adapt;            // adapt the offset to arrivals from upstream
+};
+
+// What the controller needs: cycle starts (offset included) on its own millis()
+struct CoordPlan {
+  bool active;
+  uint8_t lane;
+  uint32_t cycleMs;
+  uint32_t zeroAt;  // millis() of a recent cycle start
+};
+
+// Datagram transport: UDP on the board (interface.cpp), loopback sockets in
+// the simulator's corridor mode (sim/Corridor.cpp)
+class CoordLink {
+ public:
+  virtual ~CoordLink() {}
+  virtual void send(uint8_t to, const void *data, size_t len) = 0;
+  virtual size_t receive(void *buf, size_t size) = 0;  // next datagram, 0 when there is none
+};
+
+struct CoordNeighbor {
+  bool seen;
+  uint32_t at;  // local clock, last state
+  uint32_t cycleMs, offsetMs, greenAt;
+  uint16_t green;
+  uint8_t flags;
+};
+
+struct CoordStatus {
+  bool active;
+  bool synced;
+  int32_t clockOffset;     // ms, corridor clock - local clock
+  uint32_t roundTrip;      // ms, of the sync exchange in use
+  uint32_t syncAge;        // ms since the last sync reply (0 on node 0)
+  uint32_t cycleMs, offsetMs;
+  uint32_t position;       // ms into the cycle
+  float onGreen;           // share of profiled arrivals in the coordinated green
+  float arrivals;          // profile weight
+  unsigned long shifts;    // offset adaptations
+  CoordNeighbor upstream, downstream;
+};
+
+class Coordinator {
+ public:
+  static const int syncSamples = 8;
+  static const int maxCycle = 180;  // s, profile bins
+  static const int adaptStep = 2;   // s per cycle
+
+  // No link, or fewer than two nodes: plan() stays inactive
+  void begin(const CoordConfig &config, CoordLink *link, uint32_t now);
+
+  // Network task, every pass: answer and send datagrams, adapt the offset once
+  // per cycle. Times are the local clock, ms.
+  void service(uint32_t now);
+
+  // Vehicle on the coordinated approach at `at`
+  void onArrival(uint32_t at);
+
+  // Coordinated green lit at `at`, planned for `green` s
+  void onGreen(uint32_t at, unsigned long green);
+
+  CoordPlan plan(uint32_t now) const;
+  CoordStatus status(uint32_t now) const;
+
+ private:
+  struct SyncSample {
+    int32_t offset;
+    uint32_t roundTrip;
+  };
+
+  void receive(uint32_t now);
+  void header(CoordHeader &h, CoordType type, uint8_t to) const;
+  void sendState(uint8_t to);
+  void setCycle(uint32_t ms);
+  void clearProfile();
+  void adapt();
+  void rotate(uint32_t byMs);
+  float score(int start, int from, int to) const;
+  int bins() const { return (cycleMs + 999) / 1000; }
+  uint32_t corridor(uint32_t local) const { return local + clockOffset; }
+  uint32_t phase(uint32_t now, uint32_t offset) const;
+  uint32_t position(uint32_t now) const { return phase(now, offsetMs); }
+
+  CoordConfig config = {};
+  CoordLink *link = nullptr;
+  bool synced = false;
+  int32_t clockOffset = 0;
+  uint32_t roundTrip = 0;
+  SyncSample samples[syncSamples] = {};
+  int sampleCount = 0, sampleNext = 0;
+  uint32_t lastSyncSent = 0, lastSyncReply = 0, lastState = 0, lastAdapt = 0;
+
+  uint32_t cycleMs = 0, offsetMs = 0;
+  uint32_t epochMs = 0;  // corridor clock, a cycle start within the last cycle or so
+  uint32_t lastPosition = 0;
+  uint32_t greenAt = 0;
+  unsigned long green = 0;
+  CoordNeighbor up = {}, down = {};
+
+  float profile[maxCycle] = {};  // arrivals per s after the upstream cycle start
+  float profileTotal = 0;
+  unsigned long shifts = 0;
+};
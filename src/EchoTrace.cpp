@@ -0,0 +1,115 @@
+#include "EchoTrace.h"
+#include <LittleFS.h>
+#include "Snapshot.h"
+#include "TrafficLight.h"
+
+static const char *const path = "/trace.bin";
+static const size_t maxTraceBytes = 512 * 1024;  // ~30 min of three sensors
+static const int replayBatch = 32;
+
+static volatile TraceMode mode = TRACE_OFF;
+static volatile uint32_t replayRequest = 0;  // bumped for every replay start
+static SpscQueue<TraceSample, 64> samples;  // sensor -> network, while recording
+static File recordFile;
+static size_t recordBytes = 0;
+static TraceStats stats;
+
+// Replay state, sensor task only
+static File replayFile;
+static TraceSample pending[replayBatch];
+static int pendingCount = 0, pendingNext = 0;
+static long replayOffset = 0;  // millis() - recorded time
+static bool replayOpen = false;
+static uint32_t replayServed = 0;             // replayRequest the open file belongs to
+static volatile uint32_t replayFinished = 0;  // last replayRequest that ran to the end
+
+bool traceSetMode(TraceMode next) {
+  mode = TRACE_OFF;
+  if (recordFile) {
+    traceFlush();
+    recordFile.close();
+  }
+  if (next == TRACE_RECORD) {
+    recordFile = LittleFS.open(path, "w");
+    if (!recordFile) return false;
+    TraceHeader h = {traceMagic, traceVersion, APPROACHES, sizeof(TraceSample), (uint32_t)millis(), 0};
+    recordBytes = recordFile.write((const uint8_t *)&h, sizeof(h));
+  } else if (next == TRACE_REPLAY) {
+    if (!LittleFS.exists(path)) return false;
+    replayRequest++;
+  }
+  mode = next;
+  return true;
+}
+
+void traceTap(void *ctx, unsigned long atMs, unsigned long echoUs) {
+  if (mode != TRACE_RECORD) return;
+  if (!samples.push(TraceSample{(uint32_t)atMs, traceEcho(echoUs), (uint8_t)(uintptr_t)ctx, 0})) stats.dropped++;
+}
+
+void traceFlush() {
+  TraceSample s;
+  while (samples.pop(s)) {
+    if (!recordFile || recordBytes + sizeof(s) > maxTraceBytes) {
+      stats.full++;
+      continue;
+    }
+    recordBytes += recordFile.write((const uint8_t *)&s, sizeof(s));
+    stats.recorded++;
+  }
+}
+
+static bool refill() {
+  size_t got = replayFile.read((uint8_t *)pending, sizeof(pending));
+  pendingCount = got / sizeof(TraceSample);
+  pendingNext = 0;
+  return pendingCount > 0;
+}
+
+static void closeReplay() {
+  replayFile.close();
+  replayOpen = false;
+}
+
+bool traceReplaying(UltrasonicState *sensors, const char *const *names, int count) {
+  if (replayOpen && (mode != TRACE_REPLAY || replayServed != replayRequest)) closeReplay();
+  if (mode != TRACE_REPLAY || replayFinished == replayRequest) return false;
+
+  if (!replayOpen) {
+    replayServed = replayRequest;
+    replayFile = LittleFS.open(path, "r");
+    TraceHeader h;
+    if (!replayFile || replayFile.read((uint8_t *)&h, sizeof(h)) != sizeof(h) || h.magic != traceMagic ||
+        h.sampleSize != sizeof(TraceSample) || !refill()) {
+      if (replayFile) replayFile.close();
+      replayFinished = replayServed;
+      return false;
+    }
+    replayOffset = (long)(millis() - pending[0].atMs);
+    replayOpen = true;
+  }
+
+  unsigned long now = millis();
+  for (;;) {
+    if (pendingNext == pendingCount && !refill()) {
+      closeReplay();
+      replayFinished = replayServed;
+      return false;
+    }
+    const TraceSample &s = pending[pendingNext];
+    if ((long)(now - (s.atMs + replayOffset)) < 0) return true;
+    if (s.sensor < count) UltrasonicReplay(names[s.sensor], sensors[s.sensor], s.echoUs);
+    pendingNext++;
+    stats.replayed++;
+  }
+}
+
+const char *tracePath() {
+  return path;
+}
+
+TraceStats traceStats() {
+  TraceStats s = stats;
+  s.mode = (mode == TRACE_REPLAY && replayFinished == replayRequest) ? TRACE_OFF : mode;
+  return s;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include "TraceFormat.h"
+#include "Ultrasonic.h"
+
+// Field trace of raw echo widths in LittleFS (/trace.bin, format in
+// TraceFormat.h). Recording taps every resolved ping in the sensor task and
+// hands it to the network task for writing. Replay feeds a recorded trace
+// into the detection state machines in place of the live sensors, at the
+// recorded pace, so the controller reacts as it did in the field. The
+// simulator replays the same files as fast as the CPU allows.
+
+enum TraceMode : uint8_t {
+  TRACE_OFF,
+  TRACE_RECORD,
+  TRACE_REPLAY,
+};
+
+struct TraceStats {
+  TraceMode mode;
+  unsigned long recorded;  // samples written
+  unsigned long dropped;   // queue full
+  unsigned long full;      // past the trace size cap
+  unsigned long replayed;
+};
+
+// Network task (web API). Recording truncates /trace.bin; returns false if
+// the file cannot be opened.
+bool traceSetMode(TraceMode mode);
+
+// Sensor task: tap for UltrasonicState::tap, ctx = approach index
+void traceTap(void *ctx, unsigned long atMs, unsigned long echoUs);
+
+// Sensor task, every pass: while a replay runs, feeds the samples now due and
+// returns true (skip the live sensors). At the end of the trace the mode falls
+// back to TRACE_OFF.
+bool traceReplaying(UltrasonicState *sensors, const char *const *names, int count);
+
+// Network task: write queued samples while recording
+void traceFlush();
+
+// Path of the trace file, for download
+const char *tracePath();
+
+TraceStats traceStats();
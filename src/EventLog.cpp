@@ -0,0 +1,114 @@
+#include "EventLog.h"
+#include <LittleFS.h>
+#include "Snapshot.h"
+#include "Log.h"
+
+static const int segmentCount = 8;
+static const size_t segmentBytes = 32768;
+static const int batchRecords = 42;               // ~512 B per flash append
+static const unsigned long flushInterval = 5000;  // ms, bounds what a power cut loses
+
+struct LogEvent {
+  uint32_t at;  // millis()
+  uint8_t type;
+  uint8_t lane;
+  uint16_t v[4];
+};
+
+static SpscQueue<LogEvent, 128> events;
+static LogRecord batch[batchRecords + 1];  // +1: a LOG_TIME bridge may spill over
+static int batchCount = 0;
+static uint32_t batchBase = 0;  // encoder time before the batch's first record
+static LogEncoder encoder;
+static File segment;
+static int segmentIndex = -1;
+static size_t segmentSize = 0;
+static unsigned long lastWrite = 0;
+static EventLogStats stats;
+
+static void segmentPath(char *buf, size_t size, int i) {
+  snprintf(buf, size, "/log/%d.bin", i);
+}
+
+bool eventLogSegment(int i, char *path, size_t size) {
+  if (i < 0 || i >= segmentCount) return false;
+  segmentPath(path, size, i);
+  return true;
+}
+
+// Truncate the next segment in the ring and write its header; record deltas
+// in it count from startMs. On failure no segment is left open.
+static bool openNextSegment(uint32_t startMs) {
+  if (segment) segment.close();
+  segmentIndex = (segmentIndex + 1) % segmentCount;
+  stats.sequence++;
+  char path[16];
+  segmentPath(path, sizeof(path), segmentIndex);
+  segment = LittleFS.open(path, "w");
+  if (!segment) return false;
+
+  LogSegmentHeader h = {logMagic, logVersion, sizeof(LogRecord), stats.sequence, startMs};
+  segmentSize = segment.write((const uint8_t *)&h, sizeof(h));
+  if (segmentSize == sizeof(h)) return true;
+  segment.close();
+  return false;
+}
+
+void eventLogBegin() {
+  if (!LittleFS.exists("/log")) LittleFS.mkdir("/log");
+
+  // Resume after the newest segment
+  uint32_t newest = 0;
+  for (int i = 0; i < segmentCount; i++) {
+    char path[16];
+    segmentPath(path, sizeof(path), i);
+    File f = LittleFS.open(path, "r");
+    if (!f) continue;
+    LogSegmentHeader h;
+    if (f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == logMagic && h.sequence >= newest) {
+      newest = h.sequence;
+      segmentIndex = i;
+    }
+    f.close();
+  }
+  stats.sequence = newest;
+  uint32_t now = millis();
+  encoder.begin(now);
+  if (!openNextSegment(now)) LOG_ERROR("eventLog: cannot open segment %d", segmentIndex);
+}
+
+void eventLog(LogType type, uint8_t lane, uint16_t v0, uint16_t v1, uint16_t v2, uint16_t v3) {
+  if (events.push(LogEvent{(uint32_t)millis(), type, lane, {v0, v1, v2, v3}})) stats.logged++;
+  else stats.dropped++;
+}
+
+// Rotates when the batch doesn't fit. Without an open segment (a failed open
+// at boot or rotation) every batch tries the next one; batches written
+// nowhere count as lost.
+static void writeBatch() {
+  size_t bytes = batchCount * sizeof(LogRecord);
+  if ((!segment || segmentSize + bytes > segmentBytes) && !openNextSegment(batchBase))
+    LOG_ERROR("eventLog: cannot open segment %d", segmentIndex);
+  if (!segment || segment.write((const uint8_t *)batch, bytes) != bytes) {
+    stats.lost += batchCount;
+  } else {
+    segment.flush();
+    segmentSize += bytes;
+    stats.writes++;
+  }
+  batchCount = 0;
+  lastWrite = millis();
+}
+
+void eventLogFlush() {
+  LogEvent e;
+  while (batchCount < batchRecords && events.pop(e)) {
+    if (batchCount == 0) batchBase = encoder.last();
+    batchCount += encoder.encode(e.at, e.type, e.lane, e.v, batch + batchCount);
+  }
+  if (batchCount >= batchRecords || (batchCount > 0 && millis() - lastWrite >= flushInterval)) writeBatch();
+}
+
+EventLogStats eventLogStats() {
+  return stats;
+}
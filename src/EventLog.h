@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+#include "LogFormat.h"
+
+// Binary event history in LittleFS (format in LogFormat.h). The controller
+// task stamps events into a lock-free queue; the network task encodes them and
+// appends them to the current segment file in page-sized batches. Segments
+// /log/0.bin .. /log/7.bin are reused round-robin, so every file sees the same
+// number of rewrites and the newest history always survives.
+
+struct EventLogStats {
+  unsigned long logged;   // events accepted
+  unsigned long dropped;  // queue full
+  unsigned long writes;   // batches appended to flash
+  unsigned long lost;     // records in batches the filesystem failed to take
+  uint32_t sequence;      // current segment
+};
+
+// Call once LittleFS is mounted; starts a new segment after the newest one on flash
+void eventLogBegin();
+
+// Controller task only. Never blocks; drops the event if the queue is full.
+void eventLog(LogType type, uint8_t lane, uint16_t v0 = 0, uint16_t v1 = 0, uint16_t v2 = 0, uint16_t v3 = 0);
+
+// Network task: encode queued events and append a batch when due
+void eventLogFlush();
+
+EventLogStats eventLogStats();
+
+// Path of ring segment i for download; false past the last segment
+bool eventLogSegment(int i, char *path, size_t size);
@@ -0,0 +1,82 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Server-Sent Events fan-out. Holds up to N open event-stream responses and
+// writes each frame, serialized once into a shared buffer, to all of them, so
+// the cost of an update does not depend on how many dashboards render it.
+// A subscriber that has closed, or that cannot take a whole frame, is dropped
+// (the browser's EventSource reconnects by itself).
+//
+// Client is anything with write(const uint8_t *, size_t), connected() and
+// stop(): WiFiClient on the device, a counting stub in the host bench.
+template <typename Client, int N, size_t FrameSize = 1024>
+class EventStream {
+ public:
+  bool full() const { return count == N; }
+  int size() const { return count; }
+  unsigned long dropped() const { return lost; }
+  unsigned long frames() const { return sent; }
+
+  // Adopt a connection whose response headers (and first frame) are written
+  bool add(const Client &c) {
+    for (int i = 0; i < N; i++)
+      if (!used[i]) {
+        clients[i] = c;
+        used[i] = true;
+        count++;
+        return true;
+      }
+    return false;
+  }
+
+  // "data: <json>\n\n" into buf, for send() or a single client; 0 if it doesn't fit
+  static size_t frame(char *buf, size_t size, const char *json, size_t len) {
+    static const char head[] = "data: ";
+    if (sizeof(head) - 1 + len + 2 > size) return 0;
+    memcpy(buf, head, sizeof(head) - 1);
+    memcpy(buf + sizeof(head) - 1, json, len);
+    memcpy(buf + sizeof(head) - 1 + len, "\n\n", 2);
+    return sizeof(head) - 1 + len + 2;
+  }
+
+  // One data frame to every subscriber; returns how many took it
+  int send(const char *json, size_t len) {
+    if (!count) return 0;
+    size_t n = frame(buf, sizeof(buf), json, len);
+    if (!n) return 0;
+    sent++;
+    return broadcast((const uint8_t *)buf, n);
+  }
+
+  // Comment line, ignored by EventSource; finds dead connections while idle
+  int heartbeat() {
+    static const char ping[] = ":\n\n";
+    return broadcast((const uint8_t *)ping, sizeof(ping) - 1);
+  }
+
+ private:
+  int broadcast(const uint8_t *data, size_t len) {
+    int reached = 0;
+    for (int i = 0; i < N; i++) {
+      if (!used[i]) continue;
+      if (clients[i].connected() && clients[i].write(data, len) == len) {
+        reached++;
+        continue;
+      }
+      clients[i].stop();
+      clients[i] = Client();
+      used[i] = false;
+      count--;
+      lost++;
+    }
+    return reached;
+  }
+
+  Client clients[N];
+  bool used[N] = {};
+  int count = 0;
+  unsigned long lost = 0, sent = 0;
+  char buf[FrameSize];
+};
@@ -0,0 +1,16 @@
+#include <Arduino.h>
+#include <soc/gpio_struct.h>
+#include "SignalOutput.h"
+
+void GpioSignalOutput::begin(LampMask pins) {
+  apply(0, pins);
+  for (uint8_t pin = 0; pin < 64; pin++)
+    if (pins & lampBit(pin)) pinMode(pin, OUTPUT);
+}
+
+void GpioSignalOutput::apply(LampMask on, LampMask off) {
+  if ((uint32_t)off) GPIO.out_w1tc = (uint32_t)off;
+  if (off >> 32) GPIO.out1_w1tc.val = (uint32_t)(off >> 32);
+  if ((uint32_t)on) GPIO.out_w1ts = (uint32_t)on;
+  if (on >> 32) GPIO.out1_w1ts.val = (uint32_t)(on >> 32);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+// Fixed-bucket latency histogram in the HDR style: two buckets per power of
+// two from 1 us to 2^24 us (16.8 s), so any recorded time is within 50% of
+// its bucket bound, plus one overflow bucket. record() is a handful of
+// integer operations and never allocates.
+//
+// One task records into a histogram; others may read it while it does (as the
+// /api/metrics export does) and see a sample counted in one field but not yet
+// in another, which a scrape a moment later corrects.
+class LatencyHistogram {
+ public:
+  static const int buckets = 49;  // bucket i holds times <= bound(i); the last is unbounded
+
+  void record(uint32_t us) {
+    counts[bucket(us)]++;
+    total++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  // Buckets (1, 2, 3, 4, 6, 8, 12, ...]: for v > 2, w = v - 1 falls in
+  // [2^e, 1.5 * 2^e) or [1.5 * 2^e, 2^(e+1)), bucket 2e or 2e + 1
+  static int bucket(uint32_t us) {
+    if (us <= 2) return us <= 1 ? 0 : 1;
+    uint32_t w = us - 1;
+    int e = 31 - __builtin_clz(w);
+    int i = 2 * e + ((w >> (e - 1)) & 1);
+    return i < buckets - 1 ? i : buckets - 1;
+  }
+
+  // Upper bound of bucket i in us; 0 for the overflow bucket
+  static uint32_t bound(int i) {
+    if (i >= buckets - 1) return 0;
+    if (i < 2) return i + 1;
+    int e = i / 2;
+    return i % 2 ? (uint32_t)2 << e : (uint32_t)3 << (e - 1);
+  }
+
+  uint32_t counts[buckets] = {};
+  uint32_t total = 0;
+  uint64_t sumUs = 0;
+  uint32_t maxUs = 0;
+};
@@ -0,0 +1,178 @@
+#pragma once
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming JSON writer into a caller-provided buffer. Never allocates; if the
+// buffer is too small the output is truncated (still NUL-terminated) and ok()
+// returns false.
+class JsonWriter {
+ public:
+  JsonWriter(char *buf, size_t size) : buf(buf), size(size) {
+    if (size) buf[0] = 0;
+  }
+
+  void beginObject() {
+    separator();
+    put('{');
+    needComma = false;
+  }
+
+  void endObject() {
+    put('}');
+    needComma = true;
+  }
+
+  void key(const char *k) {
+    separator();
+    quoted(k);
+    put(':');
+    needComma = false;
+  }
+
+  void value(const char *s) { separator(); quoted(s); needComma = true; }
+  void value(bool b) { separator(); text(b ? "true" : "false"); needComma = true; }
+  void value(int v) { value((long)v); }
+  void value(unsigned int v) { value((unsigned long)v); }
+  void value(unsigned long v) { separator(); unsignedNumber(v); needComma = true; }
+  void value(long v) {
+    separator();
+    if (v < 0) {
+      put('-');
+      unsignedNumber(0UL - (unsigned long)v);
+    } else {
+      unsignedNumber((unsigned long)v);
+    }
+    needComma = true;
+  }
+
+  // Fixed-point, like String(v, decimals); non-finite values become null
+  void value(double v, uint8_t decimals) {
+    separator();
+    needComma = true;
+    if (!isfinite(v)) {
+      text("null");
+      return;
+    }
+    if (decimals > 6) decimals = 6;
+    if (v < 0) {
+      put('-');
+      v = -v;
+    }
+    static const uint32_t scales[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+    uint32_t scale = scales[decimals];
+    if (v * scale >= 1.8e19) {  // would overflow the fixed-point value
+      unsignedNumber((uint64_t)v);
+      return;
+    }
+    uint64_t fixed = (uint64_t)(v * scale + 0.5);
+    unsignedNumber(fixed / scale);
+    if (decimals) {
+      put('.');
+      char digits[6];
+      uint32_t frac = fixed % scale;
+      for (int i = decimals - 1; i >= 0; i--) {
+        digits[i] = '0' + frac % 10;
+        frac /= 10;
+      }
+      for (int i = 0; i < decimals; i++) put(digits[i]);
+    }
+  }
+
+  // Pre-serialized JSON value
+  void raw(const char *json) {
+    separator();
+    text(json);
+    needComma = true;
+  }
+
+  template <typename T>
+  void field(const char *k, T v) { key(k); value(v); }
+  void field(const char *k, double v, uint8_t decimals) { key(k); value(v, decimals); }
+
+  size_t length() const { return len; }
+  bool ok() const { return !overflow; }
+  const char *c_str() const { return buf; }
+
+ private:
+  char *buf;
+  size_t size;
+  size_t len = 0;
+  bool needComma = false;
+  bool overflow = false;
+
+  void put(char c) {
+    if (len + 1 >= size) {
+      overflow = true;
+      return;
+    }
+    buf[len++] = c;
+    buf[len] = 0;
+  }
+
+  void text(const char *s) {
+    while (*s) put(*s++);
+  }
+
+  void separator() {
+    if (needComma) put(',');
+  }
+
+  void quoted(const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    put('"');
+    for (; *s; s++) {
+      char c = *s;
+      if (c == '"' || c == '\\') {
+        put('\\');
+        put(c);
+      } else if ((unsigned char)c < 0x20) {
+        text("\\u00");
+        put(hex[(c >> 4) & 0xf]);
+        put(hex[c & 0xf]);
+      } else {
+        put(c);
+      }
+    }
+    put('"');
+  }
+
+  void unsignedNumber(uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+      digits[n++] = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    while (n) put(digits[--n]);
+  }
+};
+
+// Compile-time field schema: a name, a pointer-to-member and, for floats, the
+// number of decimals. writeFields() expands to one value() call per field.
+template <typename T, typename M>
+struct JsonField {
+  const char *name;
+  M T::*member;
+  uint8_t decimals;
+};
+
+template <typename T, typename M>
+constexpr JsonField<T, M> jsonField(const char *name, M T::*member, uint8_t decimals = 0) {
+  return JsonField<T, M>{name, member, decimals};
+}
+
+template <typename V>
+inline void jsonValue(JsonWriter &w, const V &v, uint8_t) { w.value(v); }
+inline void jsonValue(JsonWriter &w, float v, uint8_t decimals) { w.value((double)v, decimals); }
+inline void jsonValue(JsonWriter &w, double v, uint8_t decimals) { w.value(v, decimals); }
+
+template <typename T>
+inline void writeFields(JsonWriter &, const T &) {}
+
+template <typename T, typename M, typename... Rest>
+inline void writeFields(JsonWriter &w, const T &obj, const JsonField<T, M> &f, const Rest &...rest) {
+  w.key(f.name);
+  jsonValue(w, obj.*(f.member), f.decimals);
+  writeFields(w, obj, rest...);
+}
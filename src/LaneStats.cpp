@@ -0,0 +1,117 @@
+#include "LaneStats.h"
+#include <math.h>
+#include <string.h>
+
+const uint8_t LaneStats::windowBuckets[WINDOW_COUNT] = {6, 30, 90};
+
+void LaneStats::begin(const SensorTotals &t, unsigned long now) {
+  memset(ring, 0, sizeof(ring));
+  memset(winVehicles, 0, sizeof(winVehicles));
+  memset(winSpeeds, 0, sizeof(winSpeeds));
+  memset(winSpeedSum, 0, sizeof(winSpeedSum));
+  head = 0;
+  headStart = started = lastUpdate = cycleStart = now;
+  last = t;
+  queue = 0;
+  speedSamples = 0;
+  speedMean = speedM2 = 0;
+  cycleVehicles = cycleArrivals = cycleDepartures = 0;
+  cycleSpeeds = 0;
+  cycleSpeedSum = 0;
+}
+
+// Advance the ring to `now`. Each bucket entering the head leaves every window
+// as it goes; after a gap longer than the ring everything has expired.
+void LaneStats::roll(unsigned long now) {
+  if (now - headStart >= ringSize * bucketMs) {
+    memset(ring, 0, sizeof(ring));
+    memset(winVehicles, 0, sizeof(winVehicles));
+    memset(winSpeeds, 0, sizeof(winSpeeds));
+    memset(winSpeedSum, 0, sizeof(winSpeedSum));
+    headStart = now;
+    return;
+  }
+  while (now - headStart >= bucketMs) {
+    head = (head + 1) % ringSize;
+    headStart += bucketMs;
+    for (int w = 0; w < WINDOW_COUNT; w++) {
+      const Bucket &out = ring[(head + ringSize - windowBuckets[w]) % ringSize];
+      winVehicles[w] -= out.vehicles;
+      winSpeeds[w] -= out.speeds;
+      winSpeedSum[w] -= out.speedSum;
+    }
+    ring[head] = Bucket{};
+  }
+}
+
+void LaneStats::addSpeed(float speed) {
+  speedSamples++;
+  float delta = speed - speedMean;
+  speedMean += delta / speedSamples;
+  speedM2 += delta * (speed - speedMean);
+
+  uint32_t cm = (uint32_t)(speed * 100 + 0.5f);
+  Bucket &b = ring[head];
+  b.speeds++;
+  b.speedSum += cm;
+  for (int w = 0; w < WINDOW_COUNT; w++) {
+    winSpeeds[w]++;
+    winSpeedSum[w] += cm;
+  }
+}
+
+void LaneStats::observe(const SensorTotals &t, unsigned long now, float vehiclesPerCount, float discharge) {
+  roll(now);
+
+  unsigned long vehicles = t.vehicles - last.vehicles;
+  if (vehicles) {
+    ring[head].vehicles += vehicles;
+    for (int w = 0; w < WINDOW_COUNT; w++) winVehicles[w] += vehicles;
+    cycleVehicles += vehicles;
+    cycleArrivals += t.arrivals - last.arrivals;
+    cycleDepartures += t.departures - last.departures;
+    queue += vehicles * vehiclesPerCount;
+  }
+
+  // Several exits inside one tick share their mean speed
+  unsigned long speeds = t.speedCount - last.speedCount;
+  if (speeds) {
+    double sum = t.totalSpeed - last.totalSpeed;
+    for (unsigned long k = 0; k < speeds; k++) addSpeed(sum / speeds);
+    cycleSpeeds += speeds;
+    cycleSpeedSum += sum;
+  }
+
+  queue = max(0.0f, queue - discharge * (now - lastUpdate) / 1000.0f);
+  lastUpdate = now;
+  last = t;
+}
+
+void LaneStats::closeCycle(unsigned long now) {
+  float window = (now - cycleStart) / 1000.0;
+  count = cycleVehicles;
+  flow = (window > 0) ? cycleVehicles / window : 0;
+  avgSpeed = cycleSpeeds ? cycleSpeedSum / cycleSpeeds : 0;
+  arrivals = cycleArrivals;
+  departures = cycleDepartures;
+
+  cycleStart = now;
+  cycleVehicles = cycleArrivals = cycleDepartures = 0;
+  cycleSpeeds = 0;
+  cycleSpeedSum = 0;
+}
+
+// A window holds its full buckets plus the part of the head bucket elapsed so
+// far; until it has filled, it covers the time since begin()
+float LaneStats::rate(StatsWindow w) const {
+  unsigned long span = min((windowBuckets[w] - 1) * bucketMs + (lastUpdate - headStart), lastUpdate - started);
+  return span ? winVehicles[w] * 1000.0f / span : 0;
+}
+
+float LaneStats::speed(StatsWindow w) const {
+  return winSpeeds[w] ? winSpeedSum[w] / (100.0f * winSpeeds[w]) : 0;
+}
+
+float LaneStats::speedStdDev() const {
+  return speedSamples > 1 ? sqrtf(speedM2 / (speedSamples - 1)) : 0;
+}
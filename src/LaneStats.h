@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include "Ultrasonic.h"
+
+// Sliding windows kept per lane
+enum StatsWindow : uint8_t {
+  WINDOW_1MIN,
+  WINDOW_5MIN,
+  WINDOW_15MIN,
+  WINDOW_COUNT,
+};
+
+// Streaming statistics for one approach, fed with its detector totals on every
+// controller tick. Memory is fixed: detections land in a ring of 10 s buckets
+// spanning the longest window, and each window's sums are adjusted as buckets
+// enter and leave it, so an update and every read are O(1).
+class LaneStats {
+ public:
+  static const unsigned long bucketMs = 10000;
+  static const uint8_t ringSize = 90;  // 15 min
+  static const uint8_t windowBuckets[WINDOW_COUNT];
+
+  void begin(const SensorTotals &t, unsigned long now);
+
+  // Fold in the detections since the previous call. Each counted vehicle adds
+  // vehiclesPerCount to the queue estimate, which drains at `discharge` veh/s
+  // (0 while the lane is not discharging).
+  void observe(const SensorTotals &t, unsigned long now, float vehiclesPerCount, float discharge);
+
+  // Close the per-cycle window (the lane's red arrivals plus its green departures)
+  void closeCycle(unsigned long now);
+
+  float rate(StatsWindow w) const;   // veh/s
+  float speed(StatsWindow w) const;  // mean m/s, 0 without samples
+  float speedStdDev() const;         // since begin(), Welford
+
+  // Last closed cycle window
+  int count = 0;
+  float flow = 0;  // vehicles/s over the whole window (red + green)
+  float avgSpeed = 0;
+  int arrivals = 0;    // seen while red
+  int departures = 0;  // seen while green
+
+  float queue = 0;  // estimated vehicles waiting at the stop line
+  unsigned long speedSamples = 0;
+  float speedMean = 0;
+
+ private:
+  struct Bucket {
+    uint16_t vehicles;
+    uint16_t speeds;
+    uint32_t speedSum;  // cm/s
+  };
+
+  void roll(unsigned long now);
+  void addSpeed(float speed);
+
+  Bucket ring[ringSize];
+  uint8_t head = 0;
+  unsigned long headStart = 0, started = 0, lastUpdate = 0;
+  uint32_t winVehicles[WINDOW_COUNT];
+  uint32_t winSpeeds[WINDOW_COUNT];
+  uint32_t winSpeedSum[WINDOW_COUNT];
+  float speedM2 = 0;
+
+  SensorTotals last;  // totals at the previous observe()
+  unsigned long cycleStart = 0;
+  int cycleVehicles = 0, cycleArrivals = 0, cycleDepartures = 0;
+  unsigned long cycleSpeeds = 0;
+  double cycleSpeedSum = 0;
+};
@@ -0,0 +1,102 @@
+#include "Log.h"
+#include "Snapshot.h"
+
+static const size_t lineSize = 160;
+
+static MpscQueue<LogMessage, 64> ring;
+static LogStats stats;
+static char line[lineSize];  // formatted, waiting for UART room
+static size_t lineLength = 0;
+
+void logPush(const LogMessage &m) {
+  if (!ring.push(m)) stats.dropped++;  // racy across producers; a counter, not an index
+}
+
+// printf with the record's arguments: each conversion is rebuilt with its
+// flags, width and precision and a length modifier to match the stored type
+static size_t format(char *out, size_t size, const LogMessage &m) {
+  static const char levels[] = "?EWID";
+  size_t n = snprintf(out, size, "[%lu.%03lu] %c ", (unsigned long)(m.at / 1000), (unsigned long)(m.at % 1000),
+                      levels[m.level < sizeof(levels) - 1 ? m.level : 0]);
+  int arg = 0;
+  for (const char *p = m.fmt; *p && n < size - 1; p++) {
+    if (*p != '%') {
+      out[n++] = *p;
+      continue;
+    }
+    if (p[1] == '%') {
+      out[n++] = '%';
+      p++;
+      continue;
+    }
+
+    char spec[16] = "%";
+    size_t s = 1;
+    const char *q = p + 1;
+    while (*q && strchr("-+ #0123456789.", *q) && s < sizeof(spec) - 3) spec[s++] = *q++;
+    while (*q && strchr("hlzjt", *q)) q++;
+    char conv = *q;
+    if (!conv) break;
+    p = q;
+
+    int w = 0;
+    if (arg >= m.argc) {
+      w = snprintf(out + n, size - n, "<?>");
+    } else {
+      LogArgType t = m.types[arg];
+      const LogValue &v = m.args[arg];
+      arg++;
+      long i = t == LOG_ARG_UINT ? (long)v.u : t == LOG_ARG_FLOAT ? (long)v.f : v.i;
+      unsigned long u = t == LOG_ARG_INT ? (unsigned long)v.i : t == LOG_ARG_FLOAT ? (unsigned long)v.f : v.u;
+      double f = t == LOG_ARG_FLOAT ? v.f : t == LOG_ARG_UINT ? (double)v.u : (double)v.i;
+      switch (conv) {
+        case 'd': case 'i':
+          spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+          w = snprintf(out + n, size - n, spec, i);
+          break;
+        case 'u': case 'x': case 'X': case 'o':
+          spec[s++] = 'l'; spec[s++] = conv; spec[s] = 0;
+          w = snprintf(out + n, size - n, spec, u);
+          break;
+        case 'c':
+          spec[s++] = conv; spec[s] = 0;
+          w = snprintf(out + n, size - n, spec, (int)i);
+          break;
+        case 'f': case 'e': case 'g':
+          spec[s++] = conv; spec[s] = 0;
+          w = snprintf(out + n, size - n, spec, f);
+          break;
+        case 's':
+          spec[s++] = conv; spec[s] = 0;
+          w = snprintf(out + n, size - n, spec, t == LOG_ARG_STR && v.s ? v.s : "<?>");
+          break;
+        default:
+          w = snprintf(out + n, size - n, "<%c?>", conv);
+      }
+    }
+    if (w > 0) n += w;
+  }
+  if (n > size - 2) n = size - 2;  // truncated, keep the newline
+  out[n++] = '\n';
+  out[n] = 0;
+  return n;
+}
+
+void logFlush() {
+  for (;;) {
+    if (!lineLength) {
+      LogMessage m;
+      if (!ring.pop(m)) return;
+      lineLength = format(line, sizeof(line), m);
+    }
+    // A line the UART can't take whole waits for the next call
+    if ((size_t)Serial.availableForWrite() < lineLength) return;
+    Serial.print(line);
+    lineLength = 0;
+    stats.written++;
+  }
+}
+
+LogStats logStats() {
+  return stats;
+}
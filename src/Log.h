@@ -0,0 +1,114 @@
+#pragma once
+#include <Arduino.h>
+
+// Deferred serial log. LOG_ERROR() .. LOG_DEBUG() store a binary record (the
+// format string's address as its ID, the millis() stamp and up to
+// logMaxArgs raw arguments) in a lock-free ring and return; the log task
+// formats the records and writes them to the UART when it has room. The
+// calling task never waits on the serial port, so the log level doesn't
+// change signal timing.
+//
+// Levels above LOG_LEVEL compile to nothing, arguments included. Formats are
+// printf-style; a %s argument must be a string with static storage (a
+// literal), as it is only read when the record is printed.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+static const int logMaxArgs = 6;
+
+enum LogArgType : uint8_t {
+  LOG_ARG_INT,
+  LOG_ARG_UINT,
+  LOG_ARG_FLOAT,
+  LOG_ARG_STR,
+};
+
+union LogValue {
+  int32_t i;
+  uint32_t u;
+  float f;
+  const char *s;
+};
+
+struct LogArg {
+  LogArgType type;
+  LogValue v;
+};
+
+// Integers are kept as 32 bits, floating point as float
+inline LogArg logArg(long x) { LogArg a; a.type = LOG_ARG_INT; a.v.i = x; return a; }
+inline LogArg logArg(unsigned long x) { LogArg a; a.type = LOG_ARG_UINT; a.v.u = x; return a; }
+inline LogArg logArg(int x) { return logArg((long)x); }
+inline LogArg logArg(unsigned x) { return logArg((unsigned long)x); }
+inline LogArg logArg(char x) { return logArg((long)x); }
+inline LogArg logArg(bool x) { return logArg((long)x); }
+inline LogArg logArg(double x) { LogArg a; a.type = LOG_ARG_FLOAT; a.v.f = x; return a; }
+inline LogArg logArg(const char *x) { LogArg a; a.type = LOG_ARG_STR; a.v.s = x; return a; }
+
+// One queued record: 40 bytes on the ESP32
+struct LogMessage {
+  const char *fmt;
+  uint32_t at;  // millis()
+  uint8_t level;
+  uint8_t argc;
+  LogArgType types[logMaxArgs];
+  LogValue args[logMaxArgs];
+};
+
+// Queues the record; counts it as dropped if the ring is full
+void logPush(const LogMessage &m);
+
+template <typename... Args>
+inline void logWrite(uint8_t level, const char *fmt, Args... args) {
+  static_assert(sizeof...(Args) <= logMaxArgs, "too many log arguments");
+  LogArg a[sizeof...(Args) + 1] = {logArg(args)...};
+  LogMessage m;
+  m.fmt = fmt;
+  m.at = millis();
+  m.level = level;
+  m.argc = sizeof...(Args);
+  for (size_t i = 0; i < sizeof...(Args); i++) {
+    m.types[i] = a[i].type;
+    m.args[i] = a[i].v;
+  }
+  logPush(m);
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logWrite(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logWrite(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logWrite(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logWrite(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+// Log task: print queued records while the UART has room; never blocks
+void logFlush();
+
+struct LogStats {
+  unsigned long written;  // records printed
+  unsigned long dropped;  // ring full
+};
+
+LogStats logStats();
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+
+// On-flash event log format, shared by the firmware writer (EventLog.cpp) and
+// the host decoder (sim/LogDecode.cpp). A segment file is a LogSegmentHeader
+// followed by fixed-size little-endian records. Each record's time is a delta
+// from the previous record of its segment (the first from the header's start
+// time). A gap too long for 16 bits is bridged by a LOG_TIME record that
+// carries the absolute time.
+
+static const uint32_t logMagic = 0x474f4c54;  // "TLOG"
+static const uint16_t logVersion = 1;
+
+struct LogSegmentHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t sequence;  // grows by one per segment, across reboots
+  uint32_t startMs;   // millis() the record deltas start from
+};
+
+enum LogType : uint8_t {
+  LOG_TIME,       // v0/v1: absolute millis() low/high half
+  LOG_STEP,       // v0: step entered, v1: cycle (s), v2: all-red requested
+  LOG_DETECTION,  // lane; v0: speed (cm/s), v1: lane vehicle total (low 16 bits), v2: lane green
+  LOG_CYCLE,      // lane, closing a cycle; v0: count, v1: flow (veh/h), v2: avg speed (cm/s), v3: green (s)
+  LOG_PREEMPT,    // lane of the first priority request (0xff: all red); v0: PreemptPhase entered,
+                  // v1: request to target showing (ms, v0 = serve), v2: requests pending
+};
+
+struct LogRecord {
+  uint8_t type;
+  uint8_t lane;
+  uint16_t dtMs;
+  uint16_t v[4];
+};
+
+static_assert(sizeof(LogSegmentHeader) == 16, "segment header layout");
+static_assert(sizeof(LogRecord) == 12, "record layout");
+
+// Turns absolute times into the per-segment deltas
+class LogEncoder {
+ public:
+  void begin(uint32_t startMs) { lastMs = startMs; }
+  uint32_t last() const { return lastMs; }  // time the next record's delta is taken from
+
+  // Fills one or two records (a LOG_TIME bridge first when needed); returns the count
+  int encode(uint32_t at, uint8_t type, uint8_t lane, const uint16_t v[4], LogRecord *out) {
+    int n = 0;
+    uint32_t dt = at - lastMs;
+    if (dt > 0xffff) {
+      out[n++] = LogRecord{LOG_TIME, 0, 0, {(uint16_t)at, (uint16_t)(at >> 16), 0, 0}};
+      dt = 0;
+    }
+    out[n++] = LogRecord{type, lane, (uint16_t)dt, {v[0], v[1], v[2], v[3]}};
+    lastMs = at;
+    return n;
+  }
+
+ private:
+  uint32_t lastMs = 0;
+};
@@ -0,0 +1,76 @@
+#include "Metrics.h"
+
+static LatencyHistogram histograms[METRIC_COUNT];
+static uint32_t cyclesPerUs = 240;
+
+struct HistogramInfo {
+  const char *name;
+  const char *label;  // region="..." for the region family, nullptr for its own family
+  const char *help;
+};
+
+static const HistogramInfo info[METRIC_COUNT] = {
+  {"traffic_region_seconds", "controller", "Time spent in instrumented code regions"},
+  {"traffic_region_seconds", "sensor", nullptr},
+  {"traffic_region_seconds", "web", nullptr},
+  {"traffic_region_seconds", "telemetry", nullptr},
+  {"traffic_controller_late_seconds", nullptr, "Controller tick start past its 5 ms period"},
+  {"traffic_phase_switch_late_seconds", nullptr, "Timed phase step end past its planned length"},
+};
+
+void metricsBegin() {
+  cyclesPerUs = ESP.getCpuFreqMHz();
+}
+
+void metricRecord(Metric m, uint32_t us) {
+  histograms[m].record(us);
+}
+
+MetricScope::~MetricScope() {
+  metricRecord(metric, (ESP.getCycleCount() - start) / cyclesPerUs);
+}
+
+// Seconds with us resolution, no floating point
+static void seconds(char *buf, size_t size, uint64_t us) {
+  snprintf(buf, size, "%lu.%06lu", (unsigned long)(us / 1000000), (unsigned long)(us % 1000000));
+}
+
+static void writeHistogram(Print &out, int m) {
+  const HistogramInfo &h = info[m];
+  if (h.help) {
+    out.printf("# HELP %s %s\n", h.name, h.help);
+    out.printf("# TYPE %s histogram\n", h.name);
+  }
+  char region[32] = "", braced[34] = "";
+  if (h.label) {
+    snprintf(region, sizeof(region), "region=\"%s\",", h.label);
+    snprintf(braced, sizeof(braced), "{region=\"%s\"}", h.label);
+  }
+
+  // The count comes from the copied buckets, so it matches them even mid-record
+  const LatencyHistogram &src = histograms[m];
+  uint32_t counts[LatencyHistogram::buckets];
+  memcpy(counts, src.counts, sizeof(counts));
+  uint64_t sumUs = src.sumUs;
+  uint32_t cumulative = 0;
+  char le[24];
+  for (int i = 0; i < LatencyHistogram::buckets; i++) {
+    cumulative += counts[i];
+    if (i < LatencyHistogram::buckets - 1) seconds(le, sizeof(le), LatencyHistogram::bound(i));
+    else strcpy(le, "+Inf");
+    out.printf("%s_bucket{%sle=\"%s\"} %lu\n", h.name, region, le, (unsigned long)cumulative);
+  }
+  seconds(le, sizeof(le), sumUs);
+  out.printf("%s_sum%s %s\n", h.name, braced, le);
+  out.printf("%s_count%s %lu\n", h.name, braced, (unsigned long)cumulative);
+}
+
+void metricsSample(Print &out, const char *name, const char *type, const char *help, unsigned long value) {
+  out.printf("# HELP %s %s\n# TYPE %s %s\n%s %lu\n", name, help, name, type, name, value);
+}
+
+void metricsWrite(Print &out) {
+  for (int m = 0; m < METRIC_COUNT; m++) writeHistogram(out, m);
+
+  metricsSample(out, "traffic_uptime_seconds", "gauge", "Time since boot", millis() / 1000);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+#include "Histogram.h"
+
+// Timing and health counters, exported in Prometheus text format at
+// /api/metrics. Recording is a bucket increment (Histogram.h); everything is
+// formatted only when a scraper asks, so an unscraped unit pays nothing else.
+
+enum Metric : uint8_t {
+  METRIC_CONTROLLER,       // controller task: commands, service() and event logging, per tick
+  METRIC_SENSOR,           // one UltrasonicSensor() call
+  METRIC_WEB,              // handleWebServer()
+  METRIC_TELEMETRY,        // one telemetry PATCH round-trip
+  METRIC_CONTROLLER_LATE,  // controller tick started past its period
+  METRIC_SWITCH_LATE,      // phase step ended past its planned length
+  METRIC_COUNT,
+};
+
+// Call once before the tasks start
+void metricsBegin();
+
+// Each metric is recorded by one task only
+void metricRecord(Metric m, uint32_t us);
+
+// Times its scope with the CPU cycle counter. The counter is per core and
+// wraps after ~18 s at 240 MHz: for code that stays on one core (every task
+// is pinned) and returns well within that.
+class MetricScope {
+ public:
+  explicit MetricScope(Metric m) : metric(m), start(ESP.getCycleCount()) {}
+  ~MetricScope();
+
+ private:
+  Metric metric;
+  uint32_t start;
+};
+
+// All histograms and the uptime; the web server adds heap and module counters
+void metricsWrite(Print &out);
+
+// One counter or gauge sample with its HELP/TYPE lines, for metrics kept elsewhere
+void metricsSample(Print &out, const char *name, const char *type, const char *help, unsigned long value);
@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+
+// Priority requests for the controller (Intersection::request). Emergency
+// requests outrank transit ones; within a class the oldest is served first.
+
+enum PriorityClass : uint8_t {
+  PRIORITY_EMERGENCY,
+  PRIORITY_TRANSIT,
+};
+
+static const int8_t priorityAllRed = -1;  // target lane: every head red
+
+struct PriorityRequest {
+  PriorityClass cls;
+  int8_t lane;           // approach to give green, or priorityAllRed
+  unsigned long at;      // millis() when requested
+  unsigned long holdMs;  // served this long once the target shows; 0: until released
+};
+
+static const unsigned long maxPriorityHoldS = 600;  // longest hold a request may ask for
+
+// A request's hold from its text form: a whole number of seconds in
+// 1..maxPriorityHoldS. False for anything else (signs, blanks, trailing text, 0).
+inline bool parsePriorityHold(const char *text, unsigned long &holdMs) {
+  unsigned long s = 0;
+  if (!*text) return false;
+  for (const char *c = text; *c; c++) {
+    if (*c < '0' || *c > '9') return false;
+    s = s * 10 + (*c - '0');
+    if (s > maxPriorityHoldS) return false;
+  }
+  if (s == 0) return false;
+  holdMs = s * 1000;
+  return true;
+}
+
+// Where a preemption is; the heads belong to it in every phase but NONE
+enum PreemptPhase : uint8_t {
+  PREEMPT_NONE,
+  PREEMPT_CLEAR,    // greens leaving the target showing yellow
+  PREEMPT_ALL_RED,  // red clearance after the last yellow
+  PREEMPT_SERVE,    // target showing
+};
+
+// Pending requests, at most one per (class, lane); fixed size, no allocation
+class PriorityQueue {
+ public:
+  static const int capacity = 8;
+
+  // A repeat of a pending request refreshes its hold, keeping its place; false when full
+  bool add(const PriorityRequest &r) {
+    for (int i = 0; i < count; i++)
+      if (items[i].cls == r.cls && items[i].lane == r.lane) {
+        items[i].holdMs = r.holdMs;
+        return true;
+      }
+    if (count == capacity) return false;
+    items[count++] = r;
+    return true;
+  }
+
+  bool release(PriorityClass cls, int8_t lane) {
+    for (int i = 0; i < count; i++)
+      if (items[i].cls == cls && items[i].lane == lane) {
+        items[i] = items[--count];
+        return true;
+      }
+    return false;
+  }
+
+  // Highest class, then oldest; nullptr when empty
+  const PriorityRequest *top() const {
+    const PriorityRequest *best = nullptr;
+    for (int i = 0; i < count; i++)
+      if (!best || items[i].cls < best->cls || (items[i].cls == best->cls && (long)(items[i].at - best->at) < 0))
+        best = &items[i];
+    return best;
+  }
+
+  bool pending(PriorityClass cls, int8_t lane) const {
+    for (int i = 0; i < count; i++)
+      if (items[i].cls == cls && items[i].lane == lane) return true;
+    return false;
+  }
+
+  int size() const { return count; }
+
+ private:
+  PriorityRequest items[capacity];
+  int count = 0;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+// FreeRTOS task API used by Tasks.cpp. On the ESP32 this is the real kernel;
+// elsewhere a small pthread shim runs the same task graph on Linux (priorities
+// are ignored, core pinning maps to CPU affinity).
+
+#if defined(ESP_PLATFORM) || defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef void (*TaskFunction_t)(void *);
+typedef pthread_t TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdPASS 1
+#define pdFAIL 0
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+namespace rtos_shim {
+struct TaskStart {
+  TaskFunction_t fn;
+  void *arg;
+};
+
+inline void *trampoline(void *p) {
+  TaskStart start = *(TaskStart *)p;
+  delete (TaskStart *)p;
+  start.fn(start.arg);
+  return nullptr;
+}
+}  // namespace rtos_shim
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                                          UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+  (void)name;
+  (void)priority;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, stackDepth < 16384 ? 16384 : stackDepth);
+  pthread_t thread;
+  rtos_shim::TaskStart *start = new rtos_shim::TaskStart{fn, arg};
+  int err = pthread_create(&thread, &attr, rtos_shim::trampoline, start);
+  pthread_attr_destroy(&attr);
+  if (err != 0) {
+    delete start;
+    return pdFAIL;
+  }
+#if defined(__linux__)
+  if (core >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(thread, sizeof(set), &set);
+  }
+#else
+  (void)core;
+#endif
+  if (handle) *handle = thread;
+  return pdPASS;
+}
+
+inline TickType_t xTaskGetTickCount() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+  timespec ts = {(time_t)(ticks / 1000), (long)(ticks % 1000) * 1000000L};
+  nanosleep(&ts, nullptr);
+}
+
+inline void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment) {
+  *previousWake += increment;
+  TickType_t now = xTaskGetTickCount();
+  if ((int32_t)(*previousWake - now) > 0) vTaskDelay(*previousWake - now);
+}
+
+inline void vTaskDelete(void *) { pthread_exit(nullptr); }
+#endif
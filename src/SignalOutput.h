@@ -0,0 +1,34 @@
+#pragma once
+#include <stdint.h>
+
+// Lamp outputs behind the controller. The controller hands over the state of
+// every lamp at once as a pin mask, keeps it as a shadow, and passes on only
+// the difference when it changes; a SignalOutput applies that difference in
+// one batched write. GpioSignalOutput drives the ESP32 GPIO registers, the
+// simulator records and checks every transition instead (sim/Lamps.h).
+
+typedef uint64_t LampMask;  // bit n: GPIO n lit
+
+inline LampMask lampBit(uint8_t pin) {
+  return (LampMask)1 << pin;
+}
+
+class SignalOutput {
+ public:
+  virtual ~SignalOutput() {}
+
+  // Configure `pins` as outputs, all dark
+  virtual void begin(LampMask pins) = 0;
+
+  // Light `on` and darken `off` (disjoint sets), together
+  virtual void apply(LampMask on, LampMask off) = 0;
+};
+
+// ESP32: one write-1-to-clear then one write-1-to-set per GPIO bank
+// (GPIO.out_w1tc/out_w1ts, out1_* for GPIO 32+). Lamps go dark before the new
+// ones light, so a change never shows two aspects at once.
+class GpioSignalOutput : public SignalOutput {
+ public:
+  void begin(LampMask pins) override;
+  void apply(LampMask on, LampMask off) override;
+};
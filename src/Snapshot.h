@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free channels between tasks. Snapshot and SpscQueue are single-producer,
+// MpscQueue takes any number of producers; T must be trivially copyable (plain
+// structs, no String members).
+
+// Double-buffered snapshot: the writer fills the idle buffer and flips the
+// sequence; readers copy the live buffer and retry only if the writer started
+// on that same buffer while they were copying. The sequence is odd while a
+// publish is in progress and counts publishes in its upper bits.
+template <typename T>
+class Snapshot {
+ public:
+  void publish(const T &value) {
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    // The odd sequence must be visible before any of the payload is
+    std::atomic_thread_fence(std::memory_order_release);
+    buf[((s >> 1) + 1) & 1] = value;
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  T read() const {
+    T out;
+    uint32_t s;
+    do {
+      s = seq.load(std::memory_order_acquire);
+      out = buf[(s >> 1) & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // The next publish writes the other buffer; only the one after that
+      // (sequence base + 3 onwards) can have touched this one
+    } while (seq.load(std::memory_order_relaxed) - (s & ~1u) > 2);
+    return out;
+  }
+
+  uint32_t version() const { return seq.load(std::memory_order_acquire) >> 1; }
+
+ private:
+  T buf[2] = {};
+  std::atomic<uint32_t> seq{0};
+};
+
+// Bounded single-producer/single-consumer ring. push() fails when full.
+template <typename T, uint32_t N>
+class SpscQueue {
+ public:
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) return false;
+    items[h % N] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    item = items[t % N];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  T items[N];
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+};
+
+// Bounded multi-producer/single-consumer ring (Vyukov): each slot carries a
+// sequence number, producers claim slots with one compare-and-swap and never
+// wait on each other or on the consumer. push() fails when full.
+template <typename T, uint32_t N>
+class MpscQueue {
+  static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+ public:
+  MpscQueue() {
+    for (uint32_t i = 0; i < N; i++) slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot &s = slots[h % N];
+      int32_t diff = (int32_t)(s.seq.load(std::memory_order_acquire) - h);
+      if (diff < 0) return false;
+      if (diff == 0 && head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed)) {
+        s.item = item;
+        s.seq.store(h + 1, std::memory_order_release);
+        return true;
+      }
+      if (diff > 0) h = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  bool pop(T &item) {
+    Slot &s = slots[tail % N];
+    if (s.seq.load(std::memory_order_acquire) != tail + 1) return false;
+    item = s.item;
+    s.seq.store(tail + N, std::memory_order_release);
+    tail++;
+    return true;
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint32_t> seq;
+    T item;
+  };
+  Slot slots[N];
+  std::atomic<uint32_t> head{0};
+  uint32_t tail = 0;  // consumer only
+};
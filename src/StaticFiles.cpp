@@ -0,0 +1,97 @@
+#include "StaticFiles.h"
+#include <LittleFS.h>
+
+static const size_t maxPath = 32;  // LittleFS name limit, with the .gz suffix
+
+struct MimeType {
+  const char *ext;
+  const char *type;
+};
+
+// Only these are served, so the event log and trace files stay behind their own endpoints
+static const MimeType mimeTypes[] = {
+  {".html", "text/html"},
+  {".css", "text/css"},
+  {".js", "application/javascript"},
+  {".json", "application/json"},
+  {".svg", "image/svg+xml"},
+  {".png", "image/png"},
+  {".ico", "image/x-icon"},
+  {".txt", "text/plain"},
+};
+
+static const char *mimeType(const char *path) {
+  size_t len = strlen(path);
+  for (const MimeType &m : mimeTypes) {
+    size_t n = strlen(m.ext);
+    if (len > n && strcmp(path + len - n, m.ext) == 0) return m.type;
+  }
+  return nullptr;
+}
+
+// ETags by served path; the files only change with a new filesystem image
+struct EtagEntry {
+  char path[maxPath];
+  char etag[12];
+};
+static const int etagSlots = 16;
+static EtagEntry etags[etagSlots];
+static int etagNext = 0;
+
+// FNV-1a of the file contents, read in chunks; leaves the file at its start
+static const char *fileEtag(const char *path, File &f) {
+  for (const EtagEntry &e : etags)
+    if (strcmp(e.path, path) == 0) return e.etag;
+
+  uint32_t hash = 2166136261u;
+  uint8_t buf[256];
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0)
+    for (size_t i = 0; i < n; i++) hash = (hash ^ buf[i]) * 16777619u;
+  f.seek(0);
+
+  EtagEntry &e = etags[etagNext];
+  etagNext = (etagNext + 1) % etagSlots;
+  snprintf(e.path, sizeof(e.path), "%s", path);
+  snprintf(e.etag, sizeof(e.etag), "\"%08lx\"", (unsigned long)hash);
+  return e.etag;
+}
+
+void staticBegin(WebServer &server) {
+  static const char *headers[] = {"Accept-Encoding", "If-None-Match"};
+  server.collectHeaders(headers, sizeof(headers) / sizeof(headers[0]));
+}
+
+bool staticServe(WebServer &server) {
+  String uri = server.uri();
+  if (uri.endsWith("/")) uri += "index.html";
+  const char *type = mimeType(uri.c_str());
+  if (!type || uri.length() + 3 >= maxPath) return false;
+
+  char path[maxPath];
+  snprintf(path, sizeof(path), "%s", uri.c_str());
+  if (server.header("Accept-Encoding").indexOf("gzip") >= 0) {
+    char gz[maxPath];
+    snprintf(gz, sizeof(gz), "%s.gz", path);
+    if (LittleFS.exists(gz)) strcpy(path, gz);
+  }
+  if (!LittleFS.exists(path)) return false;
+  File f = LittleFS.open(path, "r");
+  if (!f) return false;
+
+  // The page revalidates on every load (a cheap 304); what it links is kept for an hour
+  const char *etag = fileEtag(path, f);
+  server.sendHeader("ETag", etag);
+  server.sendHeader("Cache-Control", strcmp(type, "text/html") ? "max-age=3600" : "no-cache");
+  server.sendHeader("Vary", "Accept-Encoding");
+  if (server.header("If-None-Match") == etag) {
+    f.close();
+    server.send(304);
+    return true;
+  }
+
+  // streamFile() adds Content-Encoding: gzip for a .gz file sent with its real type
+  server.streamFile(f, type);
+  f.close();
+  return true;
+}
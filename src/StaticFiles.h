@@ -0,0 +1,16 @@
+#pragma once
+#include <Arduino.h>
+#include <WebServer.h>
+
+// Dashboard assets from LittleFS (everything under data/). A request for /x
+// is answered with /x.gz when the client accepts gzip and the build put one
+// there (scripts/compress_data.py), else with /x; "/" is /index.html. The
+// file is streamed to the socket in chunks, never loaded whole. Responses
+// carry an ETag (a hash of the served file, computed once per boot) and a
+// Cache-Control lifetime; a matching If-None-Match gets 304.
+
+// Headers the server must collect for staticServe(); call before server.begin()
+void staticBegin(WebServer &server);
+
+// Serve the current request's URI; false if no such file (nothing sent)
+bool staticServe(WebServer &server);
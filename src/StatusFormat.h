@@ -0,0 +1,122 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Compact status frame: the content of /api/status as fixed-point binary, for
+// fleet collectors. Served as /api/status.bin and optionally sent to a UDP
+// multicast group (interface.cpp). A frame is a StatusHeader followed by
+// `lanes` StatusLane records of `laneSize` bytes, little-endian. Readers use
+// the sizes in the header, so fields appended to either struct later (with a
+// version bump) don't break older decoders.
+//
+// This header is the decoder library too: collectors include it and call
+// decodeStatus(), which only validates and converts, without allocating.
+
+static const uint32_t statusMagic = 0x41545354;  // "TSTA"
+static const uint8_t statusVersion = 1;
+static const int statusMaxLanes = 8;
+
+enum StatusFlag : uint8_t {
+  STATUS_ALL_RED = 1,  // emergency all-red requested
+  STATUS_PREEMPT = 2,  // a priority request has the heads
+};
+
+struct StatusHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t headerSize;
+  uint8_t laneSize;
+  uint8_t lanes;
+  uint32_t sequence;  // frames sent since boot, to spot gaps and reboots
+  uint32_t uptimeMs;
+  uint8_t step;       // current phase step
+  uint8_t flags;      // StatusFlag
+  uint16_t cycle;     // s
+};
+
+// Units: counts as is, rates in 0.1 veh/h, speeds in cm/s, queue in 0.1 veh
+struct StatusLane {
+  uint16_t count;        // last cycle window
+  uint16_t green;        // s
+  uint16_t flow;         // last cycle
+  uint16_t avgSpeed;
+  uint16_t queue;
+  uint16_t rate[3];      // 1 / 5 / 15 min windows
+  uint16_t speedStdDev;
+  uint8_t aspect;        // 0 red, 1 yellow, 2 green
+  uint8_t reserved;
+};
+
+static_assert(sizeof(StatusHeader) == 20, "status header layout");
+static_assert(sizeof(StatusLane) == 20, "status lane layout");
+
+static const size_t statusMaxFrame = sizeof(StatusHeader) + statusMaxLanes * sizeof(StatusLane);
+
+// Fixed-point scales: stored = value * scale, rounded and saturated
+static const float statusRateScale = 36000;  // veh/s -> 0.1 veh/h
+static const float statusSpeedScale = 100;   // m/s -> cm/s
+static const float statusQueueScale = 10;    // veh -> 0.1 veh
+
+inline uint16_t statusFixed(float v, float scale) {
+  float x = v * scale + 0.5f;
+  return x <= 0 ? 0 : x >= 65535 ? 65535 : (uint16_t)x;
+}
+
+// Decoded frame, back in the units of /api/status
+struct StatusLaneValues {
+  unsigned count;
+  unsigned green;   // s
+  float flow;       // veh/s
+  float avgSpeed;   // m/s
+  float queue;      // veh
+  float rate[3];    // veh/s
+  float speedStdDev;
+  uint8_t aspect;
+};
+
+struct StatusValues {
+  uint32_t sequence;
+  uint32_t uptimeMs;
+  uint8_t step;
+  bool allRed;
+  bool preempt;
+  unsigned cycle;
+  int lanes;
+  StatusLaneValues lane[statusMaxLanes];
+};
+
+// Decodes the frame at buf; returns its size (frames can be concatenated),
+// or 0 on a wrong magic, an unknown version or a short buffer
+inline size_t decodeStatus(const uint8_t *buf, size_t len, StatusValues &out) {
+  StatusHeader h;
+  if (len < sizeof(h)) return 0;
+  memcpy(&h, buf, sizeof(h));
+  size_t size = h.headerSize + (size_t)h.lanes * h.laneSize;
+  if (h.magic != statusMagic || h.version != statusVersion || h.headerSize < sizeof(h) ||
+      h.laneSize < sizeof(StatusLane) || h.lanes > statusMaxLanes || len < size)
+    return 0;
+
+  out.sequence = h.sequence;
+  out.uptimeMs = h.uptimeMs;
+  out.step = h.step;
+  out.allRed = h.flags & STATUS_ALL_RED;
+  out.preempt = h.flags & STATUS_PREEMPT;
+  out.cycle = h.cycle;
+  out.lanes = h.lanes;
+  const uint8_t *p = buf + h.headerSize;
+  for (int i = 0; i < h.lanes; i++, p += h.laneSize) {
+    StatusLane l;
+    memcpy(&l, p, sizeof(l));
+    StatusLaneValues &v = out.lane[i];
+    v.count = l.count;
+    v.green = l.green;
+    v.flow = l.flow / statusRateScale;
+    v.avgSpeed = l.avgSpeed / statusSpeedScale;
+    v.queue = l.queue / statusQueueScale;
+    for (int w = 0; w < 3; w++) v.rate[w] = l.rate[w] / statusRateScale;
+    v.speedStdDev = l.speedStdDev / statusSpeedScale;
+    v.aspect = l.aspect;
+  }
+  return size;
+}
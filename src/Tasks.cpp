@@ -0,0 +1,190 @@
+#include "Tasks.h"
+#include "Rtos.h"
+#include "Metrics.h"
+
+Snapshot<SensorFrame> sensorFrames;
+Snapshot<TrafficStatus> statusFrames;
+static SpscQueue<Command, 8> commands;
+static Snapshot<CoordPlan> coordPlans;  // network -> controller
+
+// Presence onsets, sensor -> controller, for gap-out timing
+struct DetectorEvent {
+  uint8_t lane;
+  unsigned long at;  // millis()
+};
+static SpscQueue<DetectorEvent, 32> detections;
+
+static ControllerConfig config;
+static CoordConfig corridor;
+static Coordinator coordinator;  // network task
+static TaskHooks *hooks;
+
+// Core / priority / period per task
+static const BaseType_t controlCore = 1, sensorCore = 1, networkCore = 0;
+static const UBaseType_t controlPriority = 3, sensorPriority = 2, networkPriority = 1, logPriority = 0;
+static const TickType_t controlPeriod = pdMS_TO_TICKS(5);
+static const TickType_t sensorPeriod = pdMS_TO_TICKS(1);
+static const TickType_t networkPeriod = pdMS_TO_TICKS(2);
+static const TickType_t logPeriod = pdMS_TO_TICKS(20);
+static const unsigned long telemetryInterval = 100;  // ms
+
+bool sendCommand(Command cmd) {
+  return commands.push(cmd);
+}
+
+static Intersection<APPROACHES> intersection(phasePlan);
+
+static TrafficStatus publishStatus() {
+  TrafficStatus st;
+  intersection.summary(st);
+  statusFrames.publish(st);
+  return st;
+}
+
+// Light sequencing, green reallocation and preemption. Only this task touches
+// the intersection (lane stats, greens and priority requests).
+static void controllerTask(void *) {
+  TickType_t wake = xTaskGetTickCount();
+  uint32_t lastStart = micros();
+  uint32_t planVersion = 0;
+  for (;;) {
+    // How far this tick started past its period: time the task was kept from running
+    uint32_t start = micros(), late = start - lastStart - controlPeriod * portTICK_PERIOD_MS * 1000;
+    metricRecord(METRIC_CONTROLLER_LATE, (int32_t)late > 0 ? late : 0);
+    lastStart = start;
+
+    {
+      MetricScope timing(METRIC_CONTROLLER);
+      Command cmd;
+      while (commands.pop(cmd)) {
+        if (cmd.type == CMD_TOGGLE_ALL_RED) intersection.toggleAllRed();
+        else if (cmd.type == CMD_PRIORITY) intersection.request(cmd.request);
+        else if (cmd.type == CMD_RELEASE) intersection.release(cmd.request.cls, cmd.request.lane);
+      }
+      DetectorEvent ev;
+      while (detections.pop(ev)) intersection.onDetection(ev.lane, ev.at);
+      if (coordPlans.version() != planVersion) {
+        planVersion = coordPlans.version();
+        intersection.coordinate(coordPlans.read());
+      }
+
+      SensorFrame frame = sensorFrames.read();
+      int step = intersection.step;
+      intersection.service(frame.lanes, config);
+      if (intersection.step != step && intersection.switchLate >= 0)
+        metricRecord(METRIC_SWITCH_LATE, intersection.switchLate * 1000);
+      hooks->controlled(frame, publishStatus());
+    }
+
+    vTaskDelayUntil(&wake, controlPeriod);
+  }
+}
+
+// Every detector samples continuously; pings are staggered inside UltrasonicSensor()
+static void sensorTask(void *) {
+  static const char *const names[] = {"U1", "U2", "U3", "U4", "U5", "U6", "U7", "U8"};
+  static_assert(APPROACHES <= sizeof(names) / sizeof(names[0]), "add detector names");
+  static UltrasonicState sensors[APPROACHES];
+  unsigned long entries[APPROACHES] = {};
+  uint32_t statusVersion = 0;
+  hooks->attachSensors(sensors, APPROACHES);
+
+  for (;;) {
+    if (statusFrames.version() != statusVersion) {
+      statusVersion = statusFrames.version();
+      TrafficStatus st = statusFrames.read();
+      for (int i = 0; i < APPROACHES; i++) sensors[i].green = (st.lanes[i].aspect == ASPECT_GREEN);
+    }
+
+    // A trace replay stands in for the live echoes
+    bool replaying = hooks->replaying(sensors, names, APPROACHES);
+    SensorFrame frame;
+    for (int i = 0; i < APPROACHES; i++) {
+      if (!replaying) {
+        MetricScope timing(METRIC_SENSOR);
+        UltrasonicSensor(names[i], sensors[i], detectorPins[i].trig, detectorPins[i].echo);
+      }
+      frame.lanes[i] = sensors[i].totals;
+      if (frame.lanes[i].entries != entries[i] && detections.push(DetectorEvent{(uint8_t)i, frame.lanes[i].lastEntry}))
+        entries[i] = frame.lanes[i].entries;
+    }
+    sensorFrames.publish(frame);
+
+    vTaskDelay(sensorPeriod);
+  }
+}
+
+// Corridor coordination: arrivals and greens on the coordinated approach in,
+// a new plan out when the cycle, offset or clock moves
+static void serviceCoordination() {
+  static unsigned long entries = 0, greenAt = 0;
+  static CoordPlan published = {};
+  if (corridor.nodes < 2) return;
+
+  SensorTotals lane = sensorFrames.read().lanes[corridor.lane];
+  if (lane.entries != entries) {
+    entries = lane.entries;
+    coordinator.onArrival(lane.lastEntry);
+  }
+  TrafficStatus st = statusFrames.read();
+  if (st.coordGreenAt != greenAt) {
+    greenAt = st.coordGreenAt;
+    coordinator.onGreen(greenAt, st.lanes[corridor.lane].green);
+  }
+  coordinator.service(millis());
+
+  CoordPlan plan = coordinator.plan(millis());
+  if (plan.active != published.active || plan.cycleMs != published.cycleMs ||
+      (plan.cycleMs && (plan.zeroAt - published.zeroAt) % plan.cycleMs)) {
+    published = plan;
+    coordPlans.publish(plan);
+  }
+}
+
+CoordStatus coordinationStatus() {
+  return coordinator.status(millis());
+}
+
+// Web server, cloud pushes, event log writes and corridor datagrams; a slow
+// request or flash write here never delays the lights
+static void networkTask(void *) {
+  unsigned long lastUpdate = 0;
+
+  for (;;) {
+    hooks->serviceNetwork();
+    serviceCoordination();
+
+    unsigned long now = millis();
+    if (now - lastUpdate >= telemetryInterval) {
+      lastUpdate = now;
+      hooks->publish(statusFrames.read());
+    }
+
+    vTaskDelay(networkPeriod);
+  }
+}
+
+// Serial log drain, below everything else: the UART only gets idle time
+static void logTask(void *) {
+  for (;;) {
+    hooks->drainLog();
+    vTaskDelay(logPeriod);
+  }
+}
+
+void startTasks(const ControllerConfig &cfg, const CoordConfig &corr, SignalOutput &signals, TaskHooks &taskHooks) {
+  config = cfg;
+  corridor = corr;
+  hooks = &taskHooks;
+  if (corridor.lane >= APPROACHES) corridor.lane = 0;
+  coordinator.begin(corridor, hooks->coordinationLink(), millis());
+  metricsBegin();
+  intersection.attach(&signals);
+  intersection.begin(cfg, millis());
+  publishStatus();
+
+  xTaskCreatePinnedToCore(controllerTask, "controller", 4096, nullptr, controlPriority, nullptr, controlCore);
+  xTaskCreatePinnedToCore(sensorTask, "sensors", 4096, nullptr, sensorPriority, nullptr, sensorCore);
+  xTaskCreatePinnedToCore(networkTask, "network", 8192, nullptr, networkPriority, nullptr, networkCore);
+  xTaskCreatePinnedToCore(logTask, "log", 3072, nullptr, logPriority, nullptr, networkCore);
+}
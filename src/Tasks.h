@@ -0,0 +1,55 @@
+#pragma once
+#include "TrafficLight.h"
+#include "Snapshot.h"
+#include "Coordination.h"
+
+// Task layout:
+//   core 1: controller (highest priority) and sensor acquisition
+//   core 0: network/telemetry, next to the WiFi stack, and the serial log drain
+// Tasks only talk through the channels below, never through each other's globals.
+
+enum CommandType : uint8_t {
+  CMD_TOGGLE_ALL_RED,
+  CMD_PRIORITY,  // queue `request`
+  CMD_RELEASE,   // drop the pending request of request.cls for request.lane
+};
+
+struct Command {
+  CommandType type;
+  PriorityRequest request;  // stamped by the sender, so queueing time counts towards the latency
+};
+
+extern Snapshot<SensorFrame> sensorFrames;    // sensor -> controller
+extern Snapshot<TrafficStatus> statusFrames;  // controller -> sensor, network
+
+// Network -> controller. Returns false if the queue is full.
+bool sendCommand(Command cmd);
+
+// Network task only (the coordinator lives there)
+CoordStatus coordinationStatus();
+
+// Everything the tasks do beyond the controller, the detectors and the
+// channels: the web server, logs, traces and the UDP link on the board
+// (Board.h), stand-ins in the host tests. Each call comes from the task named.
+class TaskHooks {
+ public:
+  virtual ~TaskHooks() {}
+  // Sensor task, once before the first sample
+  virtual void attachSensors(UltrasonicState *sensors, int count) = 0;
+  // Sensor task, every pass: true while recorded echoes stand in for the live ones
+  virtual bool replaying(UltrasonicState *sensors, const char *const *names, int count) = 0;
+  // Controller task, after each tick with the frame it used and the status it published
+  virtual void controlled(const SensorFrame &frame, const TrafficStatus &status) = 0;
+  // Network task: every pass, and every telemetry interval with the latest status
+  virtual void serviceNetwork() = 0;
+  virtual void publish(const TrafficStatus &status) = 0;
+  // Log task, every pass
+  virtual void drainLog() = 0;
+  // Corridor transport; nullptr runs every node on its own clock
+  virtual CoordLink *coordinationLink() = 0;
+};
+
+// `corridor` with fewer than two nodes runs the intersection on its own. The
+// lamps go to `signals`; `hooks` must outlive the tasks.
+void startTasks(const ControllerConfig &config, const CoordConfig &corridor, SignalOutput &signals,
+                TaskHooks &hooks);
@@ -0,0 +1,128 @@
+#include "Telemetry.h"
+#include "Metrics.h"
+#include "Log.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+
+static const int outboxSize = 16;
+static const int pathSize = 32;
+static const int jsonSize = 224;
+static const unsigned long flushInterval = 1000;  // ms
+static const uint16_t httpTimeout = 1500;         // ms, bounds a stalled response
+static const int32_t connectTimeout = 1000;       // ms, bounds the TCP connect
+static const unsigned long handshakeTimeout = 2;  // s, bounds the TLS handshake
+
+struct OutboxEntry {
+  char path[pathSize];
+  char json[jsonSize];
+};
+
+// Ring of pending updates, oldest at outboxTail
+static OutboxEntry outbox[outboxSize];
+static int outboxTail = 0;
+static int outboxCount = 0;
+
+// {"path":json,...} for one PATCH
+static char batch[outboxSize * (pathSize + jsonSize + 4) + 2];
+
+static TelemetryStats stats;
+static const char *base = nullptr;
+static char url[128];
+static unsigned long lastFlush = 0;
+
+// Persistent connection, reused across flushes
+static WiFiClient plainClient;
+static WiFiClientSecure tlsClient;
+static HTTPClient http;
+
+void telemetryBegin(const char *baseUrl) {
+  base = baseUrl;
+  if (base) snprintf(url, sizeof(url), "%s/.json", base);
+  tlsClient.setInsecure();
+  tlsClient.setHandshakeTimeout(handshakeTimeout);
+  http.setReuse(true);
+  // setTimeout() covers only reads once connected; a dead host or a stalled
+  // handshake is bounded separately
+  http.setConnectTimeout(connectTimeout);
+  http.setTimeout(httpTimeout);
+}
+
+void telemetryQueue(const char *path, const char *json) {
+  if (strlen(path) >= pathSize || strlen(json) >= jsonSize) {
+    LOG_WARN("telemetryQueue: update too large, skipped");  // path isn't static
+    return;
+  }
+  stats.queued++;
+
+  // Latest value wins for a path that is still pending
+  for (int i = 0; i < outboxCount; i++) {
+    OutboxEntry &e = outbox[(outboxTail + i) % outboxSize];
+    if (strcmp(e.path, path) == 0) {
+      strcpy(e.json, json);
+      stats.coalesced++;
+      return;
+    }
+  }
+
+  if (outboxCount == outboxSize) {
+    outboxTail = (outboxTail + 1) % outboxSize;
+    outboxCount--;
+    stats.dropped++;
+  }
+  OutboxEntry &e = outbox[(outboxTail + outboxCount) % outboxSize];
+  strcpy(e.path, path);
+  strcpy(e.json, json);
+  outboxCount++;
+}
+
+static size_t buildBatch() {
+  size_t n = 0;
+  batch[n++] = '{';
+  for (int i = 0; i < outboxCount; i++) {
+    const OutboxEntry &e = outbox[(outboxTail + i) % outboxSize];
+    n += sprintf(batch + n, "%s\"%s\":%s", i ? "," : "", e.path, e.json);
+  }
+  batch[n++] = '}';
+  batch[n] = 0;
+  return n;
+}
+
+static bool sendBatch(size_t len) {
+  if (!base) {
+    LOG_DEBUG("SIMULATED telemetry PATCH: %d updates, %u bytes", outboxCount, len);
+    return true;
+  }
+  if (WiFi.status() != WL_CONNECTED) return false;
+
+  bool tls = strncmp(base, "https", 5) == 0;
+  if (tls) http.begin(tlsClient, url);
+  else http.begin(plainClient, url);
+  http.addHeader("Content-Type", "application/json");
+  uint32_t start = micros();
+  int code = http.PATCH((uint8_t *)batch, len);
+  http.end();  // keeps the socket open (setReuse)
+  metricRecord(METRIC_TELEMETRY, micros() - start);  // can outlast the cycle counter
+
+  if (code >= 200 && code < 300) return true;
+  LOG_WARN("telemetry PATCH failed: code=%d", code);
+  return false;
+}
+
+void telemetryFlush() {
+  unsigned long now = millis();
+  if (outboxCount == 0 || now - lastFlush < flushInterval) return;
+  lastFlush = now;
+
+  size_t len = buildBatch();
+  if (sendBatch(len)) {
+    stats.batches++;
+    outboxCount = 0;
+  } else {
+    stats.failed++;
+  }
+}
+
+TelemetryStats telemetryStats() {
+  return stats;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+
+// Cloud uplink. Node updates go into a fixed-size outbox and are sent as one
+// multi-path PATCH per flush interval over a kept-alive connection. When the
+// outbox is full the oldest update is dropped, so a network stall only costs
+// stale data, never memory or controller time.
+
+struct TelemetryStats {
+  unsigned long queued;     // updates accepted
+  unsigned long coalesced;  // replaced a pending update to the same path
+  unsigned long dropped;    // evicted by drop-oldest
+  unsigned long batches;    // PATCH requests that succeeded
+  unsigned long failed;     // PATCH requests that failed (entries kept for retry)
+};
+
+// baseUrl: database root without trailing slash (http:// or https://),
+// or nullptr to only print batches (simulation).
+void telemetryBegin(const char *baseUrl);
+
+// Queue a node update (path like "lanes/laneA"); never blocks.
+void telemetryQueue(const char *path, const char *json);
+
+// Send pending updates if the flush interval has elapsed. Call from the network task.
+void telemetryFlush();
+
+TelemetryStats telemetryStats();
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+// Raw echo trace format, shared by the firmware recorder/replayer
+// (EchoTrace.cpp) and the simulator (--record-trace / --replay-trace). A trace
+// is a TraceHeader followed by one fixed-size little-endian TraceSample per
+// resolved ping, in time order.
+
+static const uint32_t traceMagic = 0x43525454;  // "TTRC"
+static const uint16_t traceVersion = 1;
+
+struct TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint8_t sensors;     // approaches recorded
+  uint8_t sampleSize;
+  uint32_t startMs;    // millis() when recording started
+  uint32_t reserved;
+};
+
+struct TraceSample {
+  uint32_t atMs;    // millis() the echo was resolved
+  uint16_t echoUs;  // echo width, 0: no echo (saturates past 65 ms, beyond range)
+  uint8_t sensor;
+  uint8_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 16, "trace header layout");
+static_assert(sizeof(TraceSample) == 8, "trace sample layout");
+
+inline uint16_t traceEcho(unsigned long echoUs) {
+  return echoUs > 0xffff ? 0xffff : (uint16_t)echoUs;
+}
@@ -2,37 +2,593 @@
 #include <Arduino.h>
 #include "Ultrasonic.h"
 #include "Adaptive.h"
+#include "Allocate.h"
+#include "LaneStats.h"
+#include "SignalOutput.h"
+#include "Preemption.h"
+#include "Coordination.h"
+#include "Log.h"
 
-// Pins
-extern const int A_R, A_Y, A_G;
-extern const int B_R, B_Y, B_G;
-extern const int C_R, C_Y, C_G;
+// Approaches (signal head + detector each) in this build; the pin tables and
+// phase plan for each supported count live in TrafficLight.cpp
+#ifndef APPROACHES
+#define APPROACHES 3
+#endif
 
-// Lane stats
-struct LaneStats {
-  int count;
+enum Aspect : uint8_t {
+  ASPECT_RED,
+  ASPECT_YELLOW,
+  ASPECT_GREEN,
+};
+
+struct SignalHead {
+  uint8_t red, yellow, green;
+};
+
+struct DetectorPins {
+  uint8_t trig, echo;
+};
+
+// One step of a phase plan: the aspect shown by every head, and the approach
+// whose green time the step runs for (-1: a clearance step of `overlap` s)
+template <size_t N>
+struct PhaseStep {
+  int8_t timing;
+  Aspect heads[N];
+};
+
+template <size_t N>
+struct PhasePlan {
+  SignalHead heads[N];
+  const PhaseStep<N> *steps;
+  uint8_t stepCount;
+};
+
+struct ControllerConfig {
+  unsigned long green;  // initial green for every approach (s)
+  unsigned long overlap;
+  float Kp, Ki, s_target, deltamax;  // AdaptiveGreen gains (see Adaptive.h)
+  unsigned long minGreen, maxGreen;
+  unsigned long minCycle, maxCycle;  // s, bounds for the Webster cycle
+  float saturationFlow;              // veh/s per lane discharging on green
+  float startupLost;                 // s lost at the start of each green
+  float gap;                         // s without an arrival that ends a green (0: fixed-time)
+  float extension;                   // s added per step while arrivals continue past the plan
+  float vehiclesPerCount;            // >1: closely spaced cars merge into one detection
+  float preemptClearance;            // s all red after the last yellow before a priority green
+};
+
+// Detector totals per approach as published by the sensor task
+struct SensorFrame {
+  SensorTotals lanes[APPROACHES];
+};
+
+// Controller state published to the sensor and network tasks
+struct LaneSummary {
+  int count;  // last cycle window
   float flow;
   float avgSpeed;
-  float flowEMA = 0;
-  float speedEMA = 0;
-  const float alpha = 0.3;
+  float queue;               // estimated vehicles waiting
+  float rate[WINDOW_COUNT];  // veh/s over the last 1/5/15 min
+  float speedStdDev;
+  unsigned long green;
+  Aspect aspect;  // shown now
+};
+
+struct TrafficStatus {
+  int currentStep;
+  bool allRed;
+  unsigned long cycle;  // s, current cycle length
+  PreemptPhase preempt;     // heads under a preemption, or on their way back to the plan
+  uint8_t priorityPending;  // queued priority requests
+  int8_t priorityLane;      // lane of the first of them (priorityAllRed: all red)
+  unsigned long preemptLatency;  // ms, request to target showing, of the last one served
+  bool coordinated;              // on the corridor's cycle and offset
+  unsigned long coordGreenAt;    // millis() the coordinated approach last turned green
+  LaneSummary lanes[APPROACHES];
+};
+
+// Site wiring for this build
+extern const PhasePlan<APPROACHES> phasePlan;
+extern const DetectorPins detectorPins[APPROACHES];
+
+// Phase sequencing and green reallocation for N approaches. Every per-cycle
+// pass is a loop over fixed-size arrays, so the cost grows only with N.
+template <size_t N>
+class Intersection {
+  static_assert(N <= maxAllocLanes, "allocateGreens() handles at most maxAllocLanes approaches");
+
+ public:
+  explicit Intersection(const PhasePlan<N> &plan) : plan(plan) {}
+
+  // Lamps go to `out` (configured here, every head red) from now on; without
+  // one the controller runs dark, as in the CPU bench
+  void attach(SignalOutput *out);
 
-  void update(float newFlow, float newSpeed) {
-    flowEMA = alpha * newFlow + (1 - alpha) * flowEMA;
-    speedEMA = alpha * newSpeed + (1 - alpha) * speedEMA;
+  void begin(const ControllerConfig &config, unsigned long now);
+
+  // Update the lane stats and advance the phase plan; reallocates greens after
+  // the last step of a cycle. The plan holds while a priority request has the heads.
+  void service(const SensorTotals *sensors, const ControllerConfig &config);
+
+  // Vehicle arrived under `lane`'s detector at millis() `at`; drives gap-out
+  void onDetection(size_t lane, unsigned long at) { lastDetection[lane] = at; }
+
+  // Queue a priority request (Preemption.h); false when the queue is full.
+  // Emergency requests take over at once, transit ones once the running green
+  // has had minGreen. Greens the target doesn't keep get `overlap` s of yellow
+  // and `preemptClearance` s of red before the target's greens light, so an
+  // emergency green shows at most overlap + preemptClearance s after the request.
+  // A repeat of the request being served restarts its hold with the new one.
+  bool request(const PriorityRequest &r);
+  bool release(PriorityClass cls, int8_t lane) { return requests.release(cls, lane); }
+
+  // Corridor coordination (Coordination.h), before each service(). While the
+  // plan is active the cycle is the corridor's and the coordinated approach's
+  // green ends its planned length after the cycle start nearest to where it
+  // began: a green that started early (side greens gapped out) runs longer,
+  // a late one (after a preemption) is cut to catch up. Greens don't extend past
+  // their split.
+  void coordinate(const CoordPlan &p) {
+    coord = p;
+    coordStep = p.active && p.cycleMs ? priorityStep(p.lane) : -1;
   }
+
+  // Emergency all-red, held until toggled again
+  void toggleAllRed();
+  bool allRedRequested() const { return requests.pending(PRIORITY_EMERGENCY, priorityAllRed); }
+
+  bool isGreen(size_t lane) const { return shown[lane] == ASPECT_GREEN; }
+  Aspect aspect(int s, size_t lane) const { return plan.steps[s].heads[lane]; }
+  void summary(TrafficStatus &st) const;
+
+  const PhasePlan<N> &plan;
+  LaneStats lanes[N];
+  AdaptiveGreen trim[N];   // per-approach feedback on the allocated green
+  unsigned long green[N];  // s, per approach
+  unsigned long cycle = 0;  // s, greens + clearances of the current cycle
+  int step = 0;
+  unsigned long prevMillis = 0;
+  unsigned long gapOuts = 0, maxOuts = 0;  // actuated green terminations
+  long switchLate = -1;                    // ms the last step ran past its planned end; -1: gap-out or preempted
+  unsigned long lampWrites = 0;            // batched output changes
+  PreemptPhase preempt = PREEMPT_NONE;
+  unsigned long preemptions = 0;                  // priority targets reached
+  unsigned long lastLatency = 0, maxLatency = 0;  // ms, request to target showing
+
+ private:
+  void startStep(const ControllerConfig &config);
+  bool stepDone(unsigned long now, const SensorTotals *sensors, const ControllerConfig &config);
+  void reallocate(const ControllerConfig &config);
+  bool preemptService(unsigned long now, const ControllerConfig &config);
+  void transition(int to, unsigned long now, const ControllerConfig &config);
+  int priorityStep(int8_t lane) const;
+  void resume(int s, unsigned long since, const ControllerConfig &config);
+  void show(const Aspect *heads, unsigned long now);
+  LampMask lamps() const;
+  void applyStep();
+
+  bool timed[N];  // approach sets the length of at least one green step
+  unsigned long lastDetection[N] = {};
+  unsigned long minEnd = 0, stepEnd = 0;  // ms after prevMillis
+  unsigned long greenStart[N] = {};
+  SignalOutput *output = nullptr;
+  LampMask lit = 0;  // shadow of the output
+  Aspect shown[N];   // every head as lit; the plan step's unless preempted
+
+  PriorityQueue requests;
+  PriorityRequest active;      // request the heads are going to or showing
+  bool recovering = false;     // going back to the plan instead
+  int target = -1;             // plan step being brought up, -1: all red
+  int interrupted = 0;         // plan step the preemption cut into
+  unsigned long clearEnd = 0;  // millis() the preemption's yellows end
+  unsigned long redSince = 0;  // millis() a head last went from yellow to red
+  unsigned long servedSince = 0;
+
+  CoordPlan coord = {};
+  int coordStep = -1;  // plan step of the coordinated green, -1: running free
 };
 
-// TrafficLight.h
-extern bool allRedLatched;
+template <size_t N>
+void Intersection<N>::attach(SignalOutput *out) {
+  LampMask pins = 0, red = 0;
+  for (size_t i = 0; i < N; i++) {
+    const SignalHead &h = plan.heads[i];
+    pins |= lampBit(h.red) | lampBit(h.yellow) | lampBit(h.green);
+    red |= lampBit(h.red);
+  }
+  output = out;
+  output->begin(pins);
+  output->apply(red, 0);
+  lit = red;
+}
+
+template <size_t N>
+void Intersection<N>::begin(const ControllerConfig &config, unsigned long now) {
+  for (size_t i = 0; i < N; i++) {
+    green[i] = config.green;
+    timed[i] = false;
+    trim[i] = AdaptiveGreen(AdaptiveParams{config.Kp, config.Ki, config.s_target, config.deltamax,
+                                           config.minGreen, config.maxGreen});
+  }
+  for (uint8_t s = 0; s < plan.stepCount; s++)
+    if (plan.steps[s].timing >= 0) timed[plan.steps[s].timing] = true;
+  step = 0;
+  prevMillis = now;
+  for (size_t i = 0; i < N; i++) {
+    greenStart[i] = now;
+    shown[i] = aspect(0, i);
+    lanes[i].begin(SensorTotals(), now);
+  }
+  preempt = PREEMPT_NONE;
+  recovering = false;
+  redSince = now;
+  cycle = 0;
+  for (uint8_t s = 0; s < plan.stepCount; s++)
+    cycle += plan.steps[s].timing >= 0 ? green[plan.steps[s].timing] : config.overlap;
+  startStep(config);
+}
 
+// Timing for the step just entered: actuated greens may end any time after
+// minGreen, fixed-time steps run exactly their planned length
+template <size_t N>
+void Intersection<N>::startStep(const ControllerConfig &config) {
+  const PhaseStep<N> &cur = plan.steps[step];
+  if (cur.timing < 0) {
+    minEnd = stepEnd = config.overlap * 1000;
+    return;
+  }
+  if (step == coordStep) {
+    long into = (int32_t)((uint32_t)prevMillis - coord.zeroAt) % (long)coord.cycleMs;
+    if (into < 0) into += coord.cycleMs;
+    if (into > (long)coord.cycleMs / 2) into -= coord.cycleMs;  // started before the cycle start
+    stepEnd = minEnd = max((long)(green[cur.timing] * 1000) - into, (long)(config.minGreen * 1000));
+    return;
+  }
+  stepEnd = minEnd = green[cur.timing] * 1000;
+  if (config.gap > 0) minEnd = min(minEnd, config.minGreen * 1000);
+}
 
-extern LaneStats laneA, laneB, laneC;
-extern UltrasonicState sensor1, sensor2, sensor3;
+// Actuated termination. The detectors sit upstream of the stop line, so a green
+// first has to discharge its estimated queue (LaneStats::queue) and any car
+// still on the detector. After that it gaps out once no vehicle has arrived for `gap` s.
+// Arrivals past the planned green extend it `extension` s at a time, up to
+// maxGreen and the green's share of a maxCycle-long cycle (max-out).
+template <size_t N>
+bool Intersection<N>::stepDone(unsigned long now, const SensorTotals *sensors, const ControllerConfig &config) {
+  const PhaseStep<N> &cur = plan.steps[step];
+  unsigned long elapsed = now - prevMillis;
+  if (cur.timing < 0 || config.gap <= 0 || step == coordStep) {
+    if (elapsed < stepEnd) return false;
+    switchLate = elapsed - stepEnd;
+    return true;
+  }
+  if (elapsed < minEnd) return false;
 
-// Traffic functions
-void trafficController(unsigned long gA, unsigned long gB, unsigned long gC, unsigned long ov, int &currentStep, unsigned long &prevMillis,
-                       unsigned long &greenA, unsigned long &greenB, unsigned long &greenC,
-                       float Kp, float s_target, float deltamax,
-                       unsigned long minGreen, unsigned long maxGreen);
-void allRed();
\ No newline at end of file
+  unsigned long headway = elapsed;
+  bool waiting = false;
+  for (size_t i = 0; i < N; i++) {
+    if (cur.heads[i] != ASPECT_GREEN) continue;
+    const SensorTotals &t = sensors[i];
+    if (lanes[i].queue > 0 || t.entries != t.vehicles) waiting = true;
+    if ((long)(lastDetection[i] - prevMillis) > 0) headway = min(headway, now - lastDetection[i]);
+  }
+  bool demand = waiting || headway < config.gap * 1000;
+  if (!demand) {
+    gapOuts++;
+    switchLate = -1;
+    return true;
+  }
+  if (elapsed < stepEnd) return false;
+
+  // Extensions stretch the cycle towards maxCycle but keep the planned split;
+  // a coordinated cycle doesn't stretch
+  unsigned long maxEnd = min(config.maxGreen * 1000, green[cur.timing] * 1000 * config.maxCycle / max(cycle, 1UL));
+  if (coordStep >= 0) maxEnd = stepEnd;
+  if (config.extension > 0 && stepEnd < maxEnd) {
+    stepEnd = min(stepEnd + (unsigned long)(config.extension * 1000), maxEnd);
+    return false;
+  }
+  maxOuts++;
+  switchLate = elapsed - stepEnd;
+  return true;
+}
+
+template <size_t N>
+void Intersection<N>::service(const SensorTotals *sensors, const ControllerConfig &config) {
+  // Input/output queue estimate: a green lane discharges at saturation flow
+  // once its start-up loss has passed
+  unsigned long now = millis();
+  for (size_t i = 0; i < N; i++) {
+    bool discharging = isGreen(i) && now - greenStart[i] >= config.startupLost * 1000;
+    lanes[i].observe(sensors[i], now, config.vehiclesPerCount, discharging ? config.saturationFlow : 0);
+  }
+
+  if (!preemptService(now, config) && stepDone(now, sensors, config)) {
+    prevMillis = now;
+    int next = (step + 1) % plan.stepCount;
+    show(plan.steps[next].heads, now);
+    if (next == 0) reallocate(config);
+    step = next;
+    startStep(config);
+  }
+
+  applyStep();
+}
+
+// End of cycle: size the next cycle with Webster's formula from the critical
+// lanes' flow ratios, then split its green budget in proportion to those flows
+// within [minGreen, maxGreen] with allocateGreens(). Flows are the lane stats'
+// 5 min windows, which smooth out single-cycle swings. Running free, each
+// approach's AdaptiveGreen then trims its share from the last cycle's flow and
+// speed, and the cycle becomes the trimmed greens plus clearances, still within
+// [minCycle, maxCycle].
+template <size_t N>
+void Intersection<N>::reallocate(const ControllerConfig &config) {
+  const unsigned long minGreen = config.minGreen, maxGreen = config.maxGreen;
+  unsigned long old[N];
+  float demand[N];
+  float flowRatio = 0;
+  unsigned long clearance = 0;
+  size_t phases = 0;
+
+  // A step's demand is its busiest green approach (the critical lane)
+  for (size_t i = 0; i < N; i++) {
+    old[i] = green[i];
+    demand[i] = 0;
+  }
+  for (uint8_t s = 0; s < plan.stepCount; s++) {
+    const PhaseStep<N> &ps = plan.steps[s];
+    if (ps.timing < 0) {
+      clearance += config.overlap;
+      continue;
+    }
+    phases++;
+    for (size_t i = 0; i < N; i++) {
+      if (ps.heads[i] != ASPECT_GREEN) continue;
+      float rate = lanes[i].rate(WINDOW_5MIN);
+      if (rate > demand[ps.timing]) demand[ps.timing] = rate;
+    }
+  }
+  for (size_t i = 0; i < N; i++) flowRatio += demand[i] / config.saturationFlow;
+
+  // Every phase needs minGreen; the lost time is the clearances plus start-up
+  // losses. A coordinated intersection runs the corridor's cycle instead.
+  unsigned long shortest = clearance + phases * minGreen;
+  unsigned long minCycle = max(config.minCycle, shortest), maxCycle = max(config.maxCycle, shortest);
+  if (coordStep >= 0) cycle = max((unsigned long)(coord.cycleMs / 1000), shortest);
+  else cycle = websterCycle(clearance + phases * config.startupLost, flowRatio, minCycle, maxCycle);
+  unsigned long greenBudget = cycle - clearance;
+
+  float weight[N];
+  unsigned long alloc[N];
+  size_t n = 0;
+  for (size_t i = 0; i < N; i++)
+    if (timed[i]) weight[n++] = demand[i];
+
+  allocateGreens(weight, n, greenBudget, minGreen, maxGreen, alloc);
+  n = 0;
+  for (size_t i = 0; i < N; i++)
+    if (timed[i]) green[i] = alloc[n++];
+
+  // A coordinated cycle is the corridor's; a lane without speed readings yet has nothing to trim on.
+  // Trims that take the cycle past its bounds are scaled back into them, keeping the trimmed split.
+  if (coordStep < 0) {
+    for (size_t i = 0; i < N; i++)
+      if (timed[i] && lanes[i].avgSpeed > 0) green[i] = trim[i].update(green[i], lanes[i].flow, lanes[i].avgSpeed);
+    cycle = clearance;
+    for (uint8_t s = 0; s < plan.stepCount; s++)
+      if (plan.steps[s].timing >= 0) cycle += green[plan.steps[s].timing];
+    if (cycle < minCycle || cycle > maxCycle) {
+      n = 0;
+      for (size_t i = 0; i < N; i++)
+        if (timed[i]) weight[n++] = green[i];
+      allocateGreens(weight, n, constrain(cycle, minCycle, maxCycle) - clearance, minGreen, maxGreen, alloc);
+      n = 0;
+      cycle = clearance;
+      for (size_t i = 0; i < N; i++)
+        if (timed[i]) cycle += green[i] = alloc[n++];
+    }
+  }
+
+  // Logging
+  LOG_INFO("=== End of Cycle (Webster) Redistribution, next cycle %lus ===", cycle);
+  for (size_t i = 0; i < N; i++) {
+    if (!timed[i]) continue;
+    LOG_INFO("Lane %c | Avg Speed %.2f | Flow %.2f | Green: %lus -> %lus", (char)('A' + i), lanes[i].avgSpeed,
+             demand[i], old[i], green[i]);
+  }
+}
+
+// Preemption, once per service(): takes the heads from the plan for the first
+// pending request, moves them through CLEAR and ALL_RED to its target, serves
+// it, and hands back to the plan when no request is left. Returns false while
+// the plan has the heads.
+template <size_t N>
+bool Intersection<N>::preemptService(unsigned long now, const ControllerConfig &config) {
+  if (preempt == PREEMPT_SERVE && !recovering && active.holdMs && now - servedSince >= active.holdMs)
+    requests.release(active.cls, active.lane);
+
+  const PriorityRequest *top = requests.top();
+  if (top) {
+    bool serving = preempt != PREEMPT_NONE && !recovering && requests.pending(active.cls, active.lane);
+    bool waits = preempt == PREEMPT_NONE && top->cls == PRIORITY_TRANSIT && plan.steps[step].timing >= 0 &&
+                 now - prevMillis < config.minGreen * 1000;
+    if ((!serving || top->cls < active.cls) && !waits) {
+      active = *top;
+      recovering = false;
+      transition(priorityStep(top->lane), now, config);
+    }
+  } else if (preempt != PREEMPT_NONE && !recovering) {
+    // Nothing left to serve. A served lane's green counts as its plan step
+    // from when it lit; otherwise the plan goes on with the green after the
+    // one that was cut into, so nobody waits out a catch-up cycle.
+    recovering = true;
+    if (preempt == PREEMPT_SERVE && target >= 0) {
+      resume(target, servedSince, config);
+    } else {
+      int s = interrupted;
+      do s = (s + 1) % plan.stepCount;
+      while (plan.steps[s].timing < 0);
+      transition(s, now, config);
+    }
+  }
+  if (preempt == PREEMPT_NONE) return false;
+
+  if (preempt == PREEMPT_CLEAR && (long)(now - clearEnd) >= 0) {
+    Aspect heads[N];
+    for (size_t i = 0; i < N; i++) heads[i] = shown[i] == ASPECT_YELLOW ? ASPECT_RED : shown[i];
+    show(heads, now);
+    preempt = PREEMPT_ALL_RED;
+  }
+  if (preempt == PREEMPT_ALL_RED) {
+    Aspect heads[N];
+    bool lighting = false;
+    for (size_t i = 0; i < N; i++) {
+      heads[i] = target >= 0 ? aspect(target, i) : ASPECT_RED;
+      lighting |= heads[i] == ASPECT_GREEN && shown[i] != ASPECT_GREEN;
+    }
+    if (lighting && now - redSince < config.preemptClearance * 1000) return true;
+    show(heads, now);
+    preempt = PREEMPT_SERVE;
+    servedSince = now;
+    if (recovering) {
+      resume(target, now, config);
+      return false;
+    }
+    lastLatency = now - active.at;
+    maxLatency = max(maxLatency, lastLatency);
+    preemptions++;
+  }
+  return true;
+}
+
+// Heads towards plan step `to` (-1: all red): greens it keeps stay lit, other
+// greens go yellow for `overlap` s, everything else holds until ALL_RED.
+// Yellows already showing keep their time.
+template <size_t N>
+void Intersection<N>::transition(int to, unsigned long now, const ControllerConfig &config) {
+  bool yellow = false;
+  for (size_t i = 0; i < N; i++) yellow |= shown[i] == ASPECT_YELLOW;
+  if (preempt == PREEMPT_NONE) {
+    interrupted = step;
+    clearEnd = yellow ? prevMillis + stepEnd : now;  // the plan only shows yellow in clearance steps
+  } else if (!yellow) {
+    clearEnd = now;
+  }
+
+  Aspect heads[N];
+  for (size_t i = 0; i < N; i++) {
+    heads[i] = shown[i];
+    if (shown[i] != ASPECT_GREEN || (to >= 0 && aspect(to, i) == ASPECT_GREEN)) continue;
+    heads[i] = ASPECT_YELLOW;
+    yellow = true;
+    if ((long)(now + config.overlap * 1000 - clearEnd) > 0) clearEnd = now + config.overlap * 1000;
+  }
+  show(heads, now);
+  target = to;
+  preempt = yellow ? PREEMPT_CLEAR : PREEMPT_ALL_RED;
+}
+
+// First green step of `lane`, -1 (all red) for priorityAllRed or a lane the plan never serves
+template <size_t N>
+int Intersection<N>::priorityStep(int8_t lane) const {
+  if (lane >= 0 && (size_t)lane < N)
+    for (uint8_t s = 0; s < plan.stepCount; s++)
+      if (plan.steps[s].timing >= 0 && aspect(s, lane) == ASPECT_GREEN) return s;
+  return -1;
+}
+
+// Back to the plan at step s (showing now), timed from `since`
+template <size_t N>
+void Intersection<N>::resume(int s, unsigned long since, const ControllerConfig &config) {
+  if (s < interrupted) reallocate(config);  // skipped past a cycle end
+  switchLate = -1;
+  preempt = PREEMPT_NONE;
+  recovering = false;
+  step = s;
+  prevMillis = since;
+  startStep(config);
+}
+
+// Lights `heads`. Closes each lane's cycle window as its green ends; the
+// window covers the red arrivals since its previous green as well as this
+// green's departures.
+template <size_t N>
+void Intersection<N>::show(const Aspect *heads, unsigned long now) {
+  for (size_t i = 0; i < N; i++) {
+    if (shown[i] == ASPECT_GREEN && heads[i] != ASPECT_GREEN) lanes[i].closeCycle(now);
+    if (heads[i] == ASPECT_GREEN && shown[i] != ASPECT_GREEN) greenStart[i] = now;
+    if (shown[i] == ASPECT_YELLOW && heads[i] == ASPECT_RED) redSince = now;
+    shown[i] = heads[i];
+  }
+}
+
+// Every lamp as shown
+template <size_t N>
+LampMask Intersection<N>::lamps() const {
+  LampMask m = 0;
+  for (size_t i = 0; i < N; i++) {
+    const SignalHead &h = plan.heads[i];
+    m |= lampBit(shown[i] == ASPECT_RED ? h.red : shown[i] == ASPECT_YELLOW ? h.yellow : h.green);
+  }
+  return m;
+}
+
+// Writes only when a lamp changes, as one batch
+template <size_t N>
+void Intersection<N>::applyStep() {
+  LampMask next = lamps();
+  if (next == lit || !output) return;
+  output->apply(next & ~lit, lit & ~next);
+  lit = next;
+  lampWrites++;
+}
+
+template <size_t N>
+bool Intersection<N>::request(const PriorityRequest &r) {
+  if (!requests.add(r)) return false;
+  if (preempt == PREEMPT_SERVE && !recovering && r.cls == active.cls && r.lane == active.lane) {
+    active.holdMs = r.holdMs;
+    servedSince = millis();
+  }
+  return true;
+}
+
+template <size_t N>
+void Intersection<N>::toggleAllRed() {
+  if (!requests.release(PRIORITY_EMERGENCY, priorityAllRed))
+    requests.add(PriorityRequest{PRIORITY_EMERGENCY, priorityAllRed, millis(), 0});
+}
+
+// Reported green per approach: its own green time, or the green of the step it
+// rides along in when another approach times that step
+template <size_t N>
+void Intersection<N>::summary(TrafficStatus &st) const {
+  static_assert(N == APPROACHES, "TrafficStatus is sized for this build's approaches");
+  st.currentStep = step;
+  st.allRed = allRedRequested();
+  st.cycle = cycle;
+  st.preempt = preempt;
+  const PriorityRequest *top = requests.top();
+  st.priorityPending = requests.size();
+  st.priorityLane = top ? top->lane : priorityAllRed;
+  st.preemptLatency = lastLatency;
+  st.coordinated = coordStep >= 0;
+  st.coordGreenAt = coord.lane < N ? greenStart[coord.lane] : 0;
+  for (size_t i = 0; i < N; i++) {
+    LaneSummary &L = st.lanes[i];
+    L.count = lanes[i].count;
+    L.flow = lanes[i].flow;
+    L.avgSpeed = lanes[i].avgSpeed;
+    L.queue = lanes[i].queue;
+    for (int w = 0; w < WINDOW_COUNT; w++) L.rate[w] = lanes[i].rate((StatsWindow)w);
+    L.speedStdDev = lanes[i].speedStdDev();
+    L.aspect = shown[i];
+    L.green = timed[i] ? green[i] : 0;
+    if (!timed[i])
+      for (uint8_t s = 0; s < plan.stepCount; s++)
+        if (plan.steps[s].heads[i] == ASPECT_GREEN && plan.steps[s].timing >= 0)
+          L.green = max(L.green, green[plan.steps[s].timing]);
+  }
+}
@@ -1,92 +1,167 @@
 #include "Ultrasonic.h"
+#include "Log.h"
 
-void UltrasonicSensor(const char* name, UltrasonicState &state, unsigned long readDuration, int trigPin, int echoPin) {
-  const int debounceCount = 2;
-  const float riseThreshold = 10;
-  const unsigned long pauseDuration = 0;
+static const float maxDistance = 550;
+static const unsigned long settleTime = 5000;  // us of quiet after an echo before the next ping
 
-  if (!state.initialized) {
-    pinMode(trigPin, OUTPUT);
-    pinMode(echoPin, INPUT);
-    state.cycleStart = millis();
-    state.initialized = true;
+// Shared trigger slot: no sensor pings until this time (micros()), so pings never overlap
+static unsigned long busUntil = 0;
+
+// Echo edge ISR: stamps the rising edge, pushes the completed pulse on the falling edge
+static void IRAM_ATTR echoIsr(void *arg) {
+  UltrasonicState *s = (UltrasonicState *)arg;
+  unsigned long t = micros();
+  if (digitalRead(s->echoPin) == HIGH) {
+    s->riseTime = t;
+    return;
   }
+  uint8_t head = s->ringHead;
+  uint8_t next = (head + 1) % UltrasonicState::ringSize;
+  if (next == s->ringTail) return;  // consumer is behind, drop this echo
+  s->ring[head].rise = s->riseTime;
+  s->ring[head].fall = t;
+  s->ringHead = next;
+}
 
-  auto getDistance = [&]() {
-    digitalWrite(trigPin, LOW);
-    delayMicroseconds(2);
-    digitalWrite(trigPin, HIGH);
-    delayMicroseconds(10);
-    digitalWrite(trigPin, LOW);
-    long duration = pulseIn(echoPin, HIGH, 30000);
-    float d = (duration * 0.0343) / 2;
-    return (d > 550 || d <= 0) ? 550 : d;
-  };
-
-  auto getAverageDistance = [&]() {
-    state.readings[state.readIndex] = getDistance();
-    state.readIndex = (state.readIndex + 1) % UltrasonicState::numReadings;
-    float sum = 0;
-    for (int i = 0; i < UltrasonicState::numReadings; i++) sum += state.readings[i];
-    return sum / UltrasonicState::numReadings;
-  };
+static float echoToDistance(unsigned long duration) {
+  float d = (duration * 0.0343) / 2;
+  return (d > maxDistance || d <= 0) ? maxDistance : d;
+}
 
-  unsigned long now = millis();
+// Median of n values (n <= DetectorConfig::maxWindow), by insertion sort of a copy
+static float median(const float *v, int n) {
+  float s[DetectorConfig::maxWindow];
+  for (int i = 0; i < n; i++) {
+    int j = i;
+    for (; j > 0 && s[j - 1] > v[i]; j--) s[j] = s[j - 1];
+    s[j] = v[i];
+  }
+  return (n % 2) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2;
+}
 
-  if (state.readingPhase) {
-    float avg = getAverageDistance();
+// Hampel filter: the sample itself, unless it is an outlier against the last
+// `window` raw samples, then their median. Bounded work per sample.
+static float hampel(UltrasonicState &state, float distance) {
+  const DetectorConfig &c = state.config;
+  int size = constrain(c.window, 1, DetectorConfig::maxWindow);
+  state.window[state.windowPos] = distance;
+  state.windowPos = (state.windowPos + 1) % size;
+  if (state.windowCount < size) state.windowCount++;
 
-    if (avg > state.peakDistance) {
-      state.peakDistance = avg;
-      state.triggerDistance = state.peakDistance - 150;
-    }
+  int n = state.windowCount;
+  float m = median(state.window, n);
+  float dev[DetectorConfig::maxWindow];
+  for (int i = 0; i < n; i++) dev[i] = fabsf(state.window[i] - m);
+  float mad = 1.4826f * median(dev, n);  // scaled to a standard deviation
+  return (fabsf(distance - m) > c.hampelK * mad) ? m : distance;
+}
 
-    Serial.print(name); 
-    Serial.print(" => Distance: "); Serial.print(avg);
-    Serial.print("  Count: "); Serial.println(state.vehicleCount);
+// Vehicle detection state machine, run once per distance sample
+static void processDistance(const char* name, UltrasonicState &state, float distance) {
+  const DetectorConfig &c = state.config;
+  unsigned long now = millis();
+  float d = hampel(state, distance);
+  // Start the background from a full window that saw the road, so lost
+  // echoes at power-up can't set it out of range
+  if (state.baseline < 0) {
+    if (state.windowCount < constrain(c.window, 1, DetectorConfig::maxWindow)) return;
+    float m = median(state.window, state.windowCount);
+    if (m >= maxDistance) return;
+    state.baseline = m;
+  }
+
+  LOG_DEBUG("%s => Distance: %.2f  Count: %lu", name, d, state.totals.vehicles);
 
-    if (avg < state.triggerDistance && !state.carPresence) {
-      state.entryCounter++;
-      if (state.entryCounter >= debounceCount) {
+  if (!state.carPresence) {
+    if (d < state.baseline - c.enterDepth) {
+      if (++state.entryCounter >= c.debounce) {
         state.carPresence = true;
         state.entryCounter = 0;
-        state.entryDistance = avg;
+        state.entryDistance = d;
         state.entryTime = now;
-        Serial.print(name); Serial.println(" => Car entered");
+        state.totals.entries++;
+        state.totals.lastEntry = now;
+        LOG_INFO("%s => Car entered", name);
       }
-    } else state.entryCounter = 0;
-
-    if (state.carPresence && avg > state.lastDistance + riseThreshold) {
-      state.exitCounter++;
-      if (state.exitCounter >= debounceCount) {
-        state.carPresence = false;
-        float travelDistance = avg - state.entryDistance;
-        float travelTime = (now - state.entryTime) / 1000.0;
-        if (travelTime > 0) {
-          float speed = (travelDistance / 100.0) / travelTime;
-          if (speed < 0) speed = 0.01;
-          state.totalSpeed += speed;
-          state.speedCount++;
-        }
-        state.vehicleCount++;
-        state.exitCounter = 0;
-        Serial.print(name); Serial.println(" => Car left");
+    } else {
+      // Clear road: follow the background both ways. A lost echo says
+      // nothing about the road and is left out.
+      state.entryCounter = 0;
+      if (d < maxDistance) state.baseline += c.baselineRate * (d - state.baseline);
+    }
+    return;
+  }
+
+  if (d > state.baseline - c.exitDepth) {
+    if (++state.exitCounter >= c.debounce) {
+      state.carPresence = false;
+      state.exitCounter = 0;
+      float travelDistance = d - state.entryDistance;
+      float travelTime = (now - state.entryTime) / 1000.0;
+      if (travelTime > 0) {
+        float speed = (travelDistance / 100.0) / travelTime;
+        if (speed < 0) speed = 0.01;
+        state.totals.totalSpeed += speed;
+        state.totals.speedCount++;
       }
-    } else state.exitCounter = 0;
+      state.totals.vehicles++;
+      if (state.green) state.totals.departures++;
+      else state.totals.arrivals++;
+      LOG_INFO("%s => Car left", name);
+    }
+  } else state.exitCounter = 0;
+}
 
-    state.lastDistance = avg;
+// One resolved ping: echo width in us, or 0 when it timed out
+static void resolveEcho(const char* name, UltrasonicState &state, unsigned long echoUs) {
+  if (state.tap) state.tap(state.tapCtx, millis(), echoUs);
+  processDistance(name, state, echoUs ? echoToDistance(echoUs) : maxDistance);
+}
 
-    if (now - state.cycleStart >= readDuration) {
-      state.vehicleCount = 0;
-      state.totalSpeed = 0;
-      state.speedCount = 0;
-      state.readingPhase = false;
-      state.cycleStart = now;
-    }
-  } else if (now - state.cycleStart >= pauseDuration) {
-    state.readingPhase = true;
-    state.cycleStart = now;
+void UltrasonicReplay(const char* name, UltrasonicState &state, unsigned long echoUs) {
+  processDistance(name, state, echoUs ? echoToDistance(echoUs) : maxDistance);
+}
+
+void UltrasonicSensor(const char* name, UltrasonicState &state, int trigPin, int echoPin) {
+  if (!state.initialized) {
+    pinMode(trigPin, OUTPUT);
+    pinMode(echoPin, INPUT);
+    digitalWrite(trigPin, LOW);
+    state.echoPin = echoPin;
+    attachInterruptArg(digitalPinToInterrupt(echoPin), echoIsr, &state, CHANGE);
+    state.initialized = true;
+  }
+
+  // Drain echoes captured since the last call
+  while (state.ringTail != state.ringHead) {
+    uint8_t tail = state.ringTail;
+    unsigned long rise = state.ring[tail].rise;
+    unsigned long fall = state.ring[tail].fall;
+    state.ringTail = (tail + 1) % UltrasonicState::ringSize;
+
+    // Late echo from a trigger that already timed out
+    if (!state.echoPending || (long)(rise - state.triggerTime) < 0) continue;
+    state.echoPending = false;
+    busUntil = micros() + settleTime;
+    resolveEcho(name, state, fall - rise);
+  }
+
+  unsigned long nowUs = micros();
+  if (state.echoPending && nowUs - state.triggerTime >= state.echoTimeout) {
+    state.echoPending = false;
+    busUntil = nowUs + settleTime;
+    resolveEcho(name, state, 0);
   }
 
-  delay(100);
+  // Trigger scheduler: next pulse once the previous echo is resolved and no
+  // other sensor is pinging (avoids acoustic crosstalk between lanes)
+  if (!state.echoPending && (long)(nowUs - busUntil) >= 0 &&
+      nowUs - state.triggerTime >= state.samplePeriod * 1000UL) {
+    digitalWrite(trigPin, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(trigPin, LOW);
+    state.triggerTime = nowUs;
+    state.echoPending = true;
+    busUntil = nowUs + state.echoTimeout + settleTime;
+  }
 }
@@ -1,31 +1,83 @@
 #pragma once
 #include <Arduino.h>
 
+// Cumulative detector counters; the controller windows them by differencing
+struct SensorTotals {
+  unsigned long vehicles = 0;
+  unsigned long arrivals = 0;    // seen while red
+  unsigned long departures = 0;  // seen while green
+  double totalSpeed = 0;
+  unsigned long speedCount = 0;
+  unsigned long entries = 0;    // presence onsets (vehicle arrived under the detector)
+  unsigned long lastEntry = 0;  // millis() of the latest onset
+};
+
+// Detection front-end settings, per sensor. Each sample goes through a Hampel
+// filter (an outlier against its window is replaced by the window median), is
+// compared with a background distance that follows the empty road up and
+// down, and starts or ends a vehicle with separate thresholds (hysteresis).
+struct DetectorConfig {
+  static const uint8_t maxWindow = 7;
+  uint8_t window = 3;          // samples, odd, at most maxWindow
+  float hampelK = 3;           // outlier beyond hampelK scaled MADs from the median
+  float baselineRate = 0.02;   // per clear-road sample; ~5 s time constant at 10 Hz
+  float enterDepth = 100;      // cm nearer than the background to start a vehicle
+  float exitDepth = 50;        // cm nearer than the background that still holds it
+  uint8_t debounce = 1;        // consecutive filtered samples to enter or leave
+};
+
+// Echo pulse captured by the edge ISR (micros() timestamps)
+struct EchoEdge {
+  unsigned long rise;
+  unsigned long fall;
+};
+
 struct UltrasonicState {
   bool initialized = false;
   bool carPresence = false;
-  int vehicleCount = 0;
+  DetectorConfig config;
 
-  static const int numReadings = 3;
-  float readings[numReadings] = {0};
-  int readIndex = 0;
+  // Raw samples for the Hampel filter, oldest at windowPos once full
+  float window[DetectorConfig::maxWindow] = {0};
+  uint8_t windowPos = 0;
+  uint8_t windowCount = 0;
+  float baseline = -1;  // cm to the empty road, < 0 until the first sample
 
   int entryCounter = 0;
   int exitCounter = 0;
 
-  float peakDistance = 0;
-  float triggerDistance = -150;
-  float lastDistance = 0;
-
-  unsigned long cycleStart = 0;
-  bool readingPhase = true;
+  bool green = false;  // lane currently discharging, set by the sensor task
+  SensorTotals totals;
 
   float entryDistance = 0;
   unsigned long entryTime = 0;
-  float totalSpeed = 0;
-  int speedCount = 0;
 
   unsigned long lastSample = 0;
+
+  // Trigger scheduler
+  unsigned long samplePeriod = 100;   // ms between trigger pulses
+  unsigned long echoTimeout = 30000;  // us, no echo => out of range
+  unsigned long triggerTime = 0;      // micros() of last trigger
+  bool echoPending = false;
+
+  // Echo capture ring, written by the ISR and drained by UltrasonicSensor()
+  static const int ringSize = 8;
+  volatile EchoEdge ring[ringSize];
+  volatile uint8_t ringHead = 0;
+  volatile uint8_t ringTail = 0;
+  volatile unsigned long riseTime = 0;
+  int echoPin = -1;
+
+  // Optional raw sample tap (trace recording): echo width in us, 0 for no echo
+  void (*tap)(void *ctx, unsigned long atMs, unsigned long echoUs) = nullptr;
+  void *tapCtx = nullptr;
 };
 
-void UltrasonicSensor(const char* name, UltrasonicState &state, unsigned long readDuration, int trigPin, int echoPin);
+// Non-blocking: fires a trigger every samplePeriod and processes whatever echoes
+// the ISR has captured since the last call. Call for every sensor on every loop;
+// triggers are staggered so only one sensor pings at a time.
+void UltrasonicSensor(const char* name, UltrasonicState &state, int trigPin, int echoPin);
+
+// Run the detection state machine on a recorded echo (us, 0: no echo) instead
+// of a live one; times come from millis() as for live samples
+void UltrasonicReplay(const char* name, UltrasonicState &state, unsigned long echoUs);
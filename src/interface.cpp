@@ -2,14 +2,24 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include "interface.h"
+#include "Tasks.h"
+#include "Telemetry.h"
+#include "JsonWriter.h"
+#include "EventLog.h"
+#include "EchoTrace.h"
+#include "EventStream.h"
+#include "StaticFiles.h"
+#include "StatusFormat.h"
+#include "Metrics.h"
+#include "Log.h"
 
 // Toggle this to 1 for Wokwi/local simulation (no WiFi/Firebase).
-// Set to 0 to enable real WiFi + Firebase REST PUTs (HTTPClient).
+// Set to 0 to enable real WiFi + batched Firebase REST PATCHes (see Telemetry.cpp).
 #define SIMULATE 1
 
 #if SIMULATE == 0
   #include <WiFi.h>
-  #include <HTTPClient.h>
+  #include <WiFiUdp.h>
 #endif
 
 #include <WebServer.h>
@@ -21,87 +31,182 @@
   // No trailing slash. Example:
   // https://traffic-system-dashboard-default-rtdb.firebaseio.com
   static const char* FIREBASE_BASE = "https://traffic-system-dashboard-default-rtdb.firebaseio.com";
+  // Binary status frames (StatusFormat.h) to a multicast group for fleet
+  // collectors, every STATUS_MULTICAST_MS; 0 disables
+  static const unsigned long STATUS_MULTICAST_MS = 0;
+  static const IPAddress STATUS_GROUP(239, 255, 77, 1);
+  static const uint16_t STATUS_PORT = 47701;
+  // Corridor coordination datagrams (CoordFormat.h); every controller of the
+  // corridor joins the group and keeps what is addressed to it
+  static const IPAddress CORRIDOR_GROUP(239, 255, 77, 2);
 #endif
 // -----------------------------------------------------------------
 
-// Externs from your other modules
-extern unsigned long greenA;
-extern unsigned long greenB;
-extern unsigned long greenC;
-extern bool allRedLatched;
+// Latest controller snapshot, refreshed by updateTrafficStatus() in the network task
+static TrafficStatus status;
 
 // Small public copy of lane state for web API / simulation
 struct PublicLane {
   int count = 0;
   float flow = 0.0f;
   float avgSpeed = 0.0f;
+  float queue = 0.0f;
+  float flow1m = 0.0f, flow5m = 0.0f, flow15m = 0.0f;
+  float speedStdDev = 0.0f;
   unsigned long greenTime = 0;
-  String status = "red";
+  const char *status = "red";
+  uint8_t aspect = ASPECT_RED;
+  bool dirty = true;  // changed since the last queued telemetry update
 };
 
-static PublicLane laneA_public, laneB_public, laneC_public;
+static PublicLane publicLanes[APPROACHES];
+static const char *const aspectNames[] = {"red", "yellow", "green"};
+static const char *const preemptNames[] = {"none", "clear", "all_red", "serve"};
 
-// Web server (works in Wokwi)
-static WebServer server(80);
+// JSON key / telemetry path for approach i: "laneA", "lanes/laneA", "greenA", ...
+static void laneKey(char *buf, size_t size, const char *prefix, int i) {
+  snprintf(buf, size, "%s%c", prefix, 'A' + i);
+}
 
-// Simple uptime timestamp (no RTC) for JSON
-String getIsoTimestamp() {
-  // returns seconds since boot as string (simple, monotonic)
-  unsigned long s = millis() / 1000;
-  return String(s);
+// JSON schemas shared by /api/status and telemetry
+static void writeLane(JsonWriter &w, const PublicLane &L) {
+  writeFields(w, L,
+              jsonField("count", &PublicLane::count),
+              jsonField("flow", &PublicLane::flow, 4),
+              jsonField("avgSpeed", &PublicLane::avgSpeed, 4),
+              jsonField("queue", &PublicLane::queue, 1),
+              jsonField("flow1m", &PublicLane::flow1m, 4),
+              jsonField("flow5m", &PublicLane::flow5m, 4),
+              jsonField("flow15m", &PublicLane::flow15m, 4),
+              jsonField("speedStdDev", &PublicLane::speedStdDev, 4),
+              jsonField("greenTime", &PublicLane::greenTime),
+              jsonField("status", &PublicLane::status));
 }
 
-// ---------- Helpers (Firebase stub or real PUT) ----------
-#if SIMULATE == 0
-// Perform HTTP PUT to Firebase REST endpoint (path like "lanes/laneA")
-static bool firebasePut(const String &path, const String &jsonPayload) {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("firebasePut: WiFi not connected");
-    return false;
+static void writeGreens(JsonWriter &w, const TrafficStatus &st) {
+  char key[8];
+  for (int i = 0; i < APPROACHES; i++) {
+    laneKey(key, sizeof(key), "green", i);
+    w.field(key, st.lanes[i].green);
   }
-  HTTPClient http;
-  String url = String(FIREBASE_BASE) + "/" + path + ".json";
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  int code = http.PUT(jsonPayload);
-  String resp = http.getString();
-  http.end();
-  if (code >= 200 && code < 300) {
-    return true;
-  } else {
-    Serial.printf("firebasePut failed: code=%d resp=%s\n", code, resp.c_str());
-    return false;
+  w.field("allRed", st.allRed);
+  w.field("cycle", st.cycle);
+  w.field("preempt", preemptNames[st.preempt]);
+  w.field("priorityPending", st.priorityPending);
+}
+
+// Seconds since boot (no RTC), the timestamp on status and lane telemetry
+static void uptimeString(char *buf, size_t size) {
+  snprintf(buf, size, "%lu", millis() / 1000);
+}
+
+// Full /api/status document; event stream frames carry parts of the same shape
+static void writeStatus(JsonWriter &w) {
+  w.beginObject();
+  w.key("status");
+  w.beginObject();
+  w.field("currentStep", status.currentStep);
+  writeGreens(w, status);
+  w.endObject();
+  w.key("lanes");
+  w.beginObject();
+  for (int i = 0; i < APPROACHES; i++) {
+    char name[8];
+    laneKey(name, sizeof(name), "lane", i);
+    w.key(name);
+    w.beginObject();
+    writeLane(w, publicLanes[i]);
+    w.endObject();
   }
+  w.endObject();
+  w.endObject();
 }
-#else
-// Simulation: just print, don't network
-static bool firebasePut(const String &path, const String &jsonPayload) {
-  Serial.println("SIMULATED firebasePut -> " + path);
-  Serial.println(jsonPayload);
-  return true;
+
+// Same content as writeStatus(), fixed-point (StatusFormat.h); returns the frame size
+static size_t encodeStatus(uint8_t *buf) {
+  static_assert(APPROACHES <= statusMaxLanes && WINDOW_COUNT == 3, "status frame layout");
+  static uint32_t sequence = 0;
+  StatusHeader h = {statusMagic, statusVersion, sizeof(StatusHeader), sizeof(StatusLane), APPROACHES,
+                    sequence++, (uint32_t)millis(), (uint8_t)status.currentStep,
+                    (uint8_t)((status.allRed ? STATUS_ALL_RED : 0) | (status.preempt ? STATUS_PREEMPT : 0)),
+                    statusFixed(status.cycle, 1)};
+  memcpy(buf, &h, sizeof(h));
+  for (int i = 0; i < APPROACHES; i++) {
+    const PublicLane &L = publicLanes[i];
+    StatusLane l = {statusFixed(L.count, 1), statusFixed(L.greenTime, 1), statusFixed(L.flow, statusRateScale),
+                    statusFixed(L.avgSpeed, statusSpeedScale), statusFixed(L.queue, statusQueueScale),
+                    {statusFixed(L.flow1m, statusRateScale), statusFixed(L.flow5m, statusRateScale),
+                     statusFixed(L.flow15m, statusRateScale)},
+                    statusFixed(L.speedStdDev, statusSpeedScale), L.aspect, 0};
+    memcpy(buf + sizeof(h) + i * sizeof(l), &l, sizeof(l));
+  }
+  return sizeof(h) + APPROACHES * sizeof(StatusLane);
 }
-#endif
 
-// POST for logs (optional)
-#if SIMULATE == 0
-static bool firebasePost(const String &path, const String &jsonPayload) {
-  if (WiFi.status() != WL_CONNECTED) return false;
-  HTTPClient http;
-  String url = String(FIREBASE_BASE) + "/" + path + ".json";
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  int code = http.POST(jsonPayload);
-  String resp = http.getString();
-  http.end();
-  return (code >= 200 && code < 300);
+// Web server (works in Wokwi)
+static WebServer server(80);
+
+// Dashboards subscribed to /api/events
+static EventStream<WiFiClient, 8> events;
+static const unsigned long heartbeatInterval = 15000;  // ms
+static unsigned long lastHeartbeat = 0;
+
+// ?class=emergency|transit&lane=A..|all[&hold=S] as a request stamped now; no hold: until released.
+// A hold out of range or not a number is refused (parsePriorityHold()).
+static bool priorityArgs(PriorityRequest &r) {
+  String cls = server.arg("class"), lane = server.arg("lane");
+  if (cls == "emergency") r.cls = PRIORITY_EMERGENCY;
+  else if (cls == "transit") r.cls = PRIORITY_TRANSIT;
+  else return false;
+  if (lane == "all") r.lane = priorityAllRed;
+  else if (lane.length() == 1 && lane[0] >= 'A' && lane[0] < 'A' + APPROACHES) r.lane = lane[0] - 'A';
+  else return false;
+  r.at = millis();
+  r.holdMs = 0;
+  return !server.hasArg("hold") || parsePriorityHold(server.arg("hold").c_str(), r.holdMs);
 }
-#else
-static bool firebasePost(const String &path, const String &jsonPayload) {
-  Serial.println("SIMULATED firebasePost -> " + path);
-  Serial.println(jsonPayload);
-  return true;
+
+static void sendPriority(CommandType type) {
+  Command cmd = {type, {}};
+  if (!priorityArgs(cmd.request)) {
+    server.send(400, "application/json", "{\"error\":\"need class=emergency|transit, lane and optionally hold=1..600\"}");
+    return;
+  }
+  if (!sendCommand(cmd)) {
+    server.send(503, "application/json", "{\"error\":\"busy\"}");
+    return;
+  }
+  server.send(202, "application/json", "{\"queued\":true}");
 }
-#endif
+
+// Response body sent in chunks as it is printed, so a long one is never held whole
+class ChunkedResponse : public Print {
+ public:
+  ChunkedResponse(const char *type) {
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, type, "");
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t i = 0; i < len; i++) {
+      if (used == sizeof(buf)) sendChunk();
+      buf[used++] = data[i];
+    }
+    return len;
+  }
+  void sendChunk() {
+    if (used) server.sendContent(buf, used);
+    used = 0;
+  }
+  ~ChunkedResponse() {
+    sendChunk();
+    server.sendContent("");  // last chunk
+  }
+
+ private:
+  char buf[512];
+  size_t used = 0;
+};
 
 // ---------------- Public API (called by your trafficController / main) ----------------
 void connectWiFi() {
@@ -119,11 +224,61 @@ void connectWiFi() {
   } else {
     Serial.println("\nWiFi connect failed/time out.");
   }
+  telemetryBegin(FIREBASE_BASE);
 #else
   Serial.println("SIMULATION MODE - skipping WiFi connect");
+  telemetryBegin(nullptr);
+#endif
+}
+
+#if SIMULATE == 0
+class UdpCoordLink : public CoordLink {
+ public:
+  void send(uint8_t, const void *data, size_t len) override {
+    if (!begin()) return;
+    udp.beginPacket(CORRIDOR_GROUP, coordPort);
+    udp.write((const uint8_t *)data, len);
+    udp.endPacket();
+  }
+
+  size_t receive(void *buf, size_t size) override {
+    if (!begin()) return 0;
+    int n = udp.parsePacket();
+    return n > 0 ? udp.read((uint8_t *)buf, size) : 0;
+  }
+
+ private:
+  bool begin() {
+    if (WiFi.status() != WL_CONNECTED) return false;
+    if (!joined) joined = udp.beginMulticast(CORRIDOR_GROUP, coordPort);
+    return joined;
+  }
+
+  WiFiUDP udp;
+  bool joined = false;
+};
+#endif
+
+CoordLink *coordinationLink() {
+#if SIMULATE == 0
+  static UdpCoordLink link;
+  return &link;
+#else
+  return nullptr;
 #endif
 }
 
+static void writeNeighbor(JsonWriter &w, const char *name, const CoordNeighbor &n) {
+  w.key(name);
+  w.beginObject();
+  w.field("seen", n.seen);
+  w.field("offsetMs", (unsigned long)n.offsetMs);
+  w.field("cycleMs", (unsigned long)n.cycleMs);
+  w.field("green", (unsigned long)n.green);
+  w.field("synced", (n.flags & COORD_SYNCED) != 0);
+  w.endObject();
+}
+
 void startWebServer() {
   // mount LittleFS if not mounted
   if (!LittleFS.begin()) {
@@ -131,52 +286,157 @@ void startWebServer() {
     // still continue; some tests may not need FS
   }
 
-  // root serves index.html if exists
-  server.on("/", HTTP_GET, []() {
-    if (LittleFS.exists("/index.html")) {
-      File f = LittleFS.open("/index.html", "r");
-      if (f) {
-        String content;
-        while (f.available()) content += char(f.read());
-        f.close();
-        server.send(200, "text/html", content);
-        return;
-      }
+  // API for status used by dashboard (same shape as we described earlier)
+  server.on("/api/status", HTTP_GET, []() {
+    static char body[256 + 256 * APPROACHES];
+    JsonWriter w(body, sizeof(body));
+    writeStatus(w);
+    server.send_P(200, "application/json", body, w.length());
+  });
+
+  // Same, as one StatusFormat.h frame
+  server.on("/api/status.bin", HTTP_GET, []() {
+    static uint8_t frame[statusMaxFrame];
+    size_t n = encodeStatus(frame);
+    server.send_P(200, "application/octet-stream", (const char *)frame, n);
+  });
+
+  // Push updates: the full status first, then only what changed, as it changes
+  server.on("/api/events", HTTP_GET, []() {
+    if (events.full()) {
+      server.send(503, "application/json", "{\"error\":\"too many subscribers\"}");
+      return;
     }
-    server.send(200, "text/plain", "Traffic controller (simulated)");
+    static char body[256 + 256 * APPROACHES], frame[sizeof(body) + 8];
+    JsonWriter w(body, sizeof(body));
+    writeStatus(w);
+    size_t n = decltype(events)::frame(frame, sizeof(frame), body, w.length());
+    WiFiClient client = server.client();
+    client.setNoDelay(true);
+    client.print("HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                 "Connection: keep-alive\r\nAccess-Control-Allow-Origin: *\r\n\r\n");
+    if (client.write((const uint8_t *)frame, n) == n) events.add(client);
   });
 
-  // API for status used by dashboard (same shape as we described earlier)
-  server.on("/api/status", HTTP_GET, []() {
-    String j = "{";
-    j += "\"status\":{";
-    j += "\"greenA\":" + String(greenA) + ",";
-    j += "\"greenB\":" + String(greenB) + ",";
-    j += "\"greenC\":" + String(greenC) + ",";
-    j += "\"allRed\":" + String(allRedLatched ? "true" : "false");
-    j += "},";
-    auto laneJson = [](const PublicLane &L) {
-      String s = "{";
-      s += "\"count\":" + String(L.count) + ",";
-      s += "\"flow\":" + String(L.flow, 4) + ",";
-      s += "\"avgSpeed\":" + String(L.avgSpeed, 4) + ",";
-      s += "\"greenTime\":" + String(L.greenTime) + ",";
-      s += "\"status\":\"" + L.status + "\"";
-      s += "}";
-      return s;
-    };
-    j += "\"lanes\":{";
-    j += "\"laneA\":" + laneJson(laneA_public) + ",";
-    j += "\"laneB\":" + laneJson(laneB_public) + ",";
-    j += "\"laneC\":" + laneJson(laneC_public);
-    j += "}}";
-    server.send(200, "application/json", j);
+  // Prometheus scrape: region timings, lateness, heap and drop counters
+  server.on("/api/metrics", HTTP_GET, []() {
+    ChunkedResponse out("text/plain; version=0.0.4");
+    metricsWrite(out);
+    metricsSample(out, "traffic_heap_free_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+    metricsSample(out, "traffic_heap_min_free_bytes", "gauge", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    metricsSample(out, "traffic_heap_max_alloc_bytes", "gauge", "Largest allocatable block", ESP.getMaxAllocHeap());
+
+    TelemetryStats t = telemetryStats();
+    metricsSample(out, "traffic_telemetry_queued_total", "counter", "Telemetry updates accepted", t.queued);
+    metricsSample(out, "traffic_telemetry_coalesced_total", "counter", "Telemetry updates replaced by a newer one",
+                  t.coalesced);
+    metricsSample(out, "traffic_telemetry_dropped_total", "counter", "Telemetry updates evicted from a full outbox",
+                  t.dropped);
+    metricsSample(out, "traffic_telemetry_batches_total", "counter", "Telemetry PATCH requests that succeeded",
+                  t.batches);
+    metricsSample(out, "traffic_telemetry_failed_total", "counter", "Telemetry PATCH requests that failed", t.failed);
+
+    EventLogStats l = eventLogStats();
+    metricsSample(out, "traffic_eventlog_dropped_total", "counter", "Events dropped on a full log queue", l.dropped);
+    metricsSample(out, "traffic_eventlog_lost_total", "counter", "Log records the filesystem did not take", l.lost);
+
+    TraceStats tr = traceStats();
+    metricsSample(out, "traffic_trace_dropped_total", "counter", "Echo trace samples dropped", tr.dropped + tr.full);
+
+    LogStats lg = logStats();
+    metricsSample(out, "traffic_log_dropped_total", "counter", "Serial log records dropped on a full ring", lg.dropped);
+    metricsSample(out, "traffic_sse_dropped_total", "counter", "Event stream subscribers dropped", events.dropped());
+    metricsSample(out, "traffic_sse_subscribers", "gauge", "Open event streams", events.size());
   });
 
-  // optional toggle (useful during demos)
+  // Corridor coordination: clock sync, cycle position, offset and neighbours
+  server.on("/api/coordination", HTTP_GET, []() {
+    static char body[512];
+    CoordStatus s = coordinationStatus();
+    JsonWriter w(body, sizeof(body));
+    w.beginObject();
+    w.field("active", s.active);
+    w.field("synced", s.synced);
+    w.field("clockOffsetMs", (long)s.clockOffset);
+    w.field("roundTripMs", (unsigned long)s.roundTrip);
+    w.field("syncAgeMs", (unsigned long)s.syncAge);
+    w.field("cycleMs", (unsigned long)s.cycleMs);
+    w.field("offsetMs", (unsigned long)s.offsetMs);
+    w.field("positionMs", (unsigned long)s.position);
+    w.field("arrivals", s.arrivals, 1);
+    w.field("onGreen", s.onGreen, 3);
+    w.field("shifts", s.shifts);
+    writeNeighbor(w, "upstream", s.upstream);
+    writeNeighbor(w, "downstream", s.downstream);
+    w.endObject();
+    server.send_P(200, "application/json", body, w.length());
+  });
+
+  // Event log segment ?segment=N, raw, for the host decoder (program --decode-log)
+  server.on("/api/log", HTTP_GET, []() {
+    char path[16];
+    int i = server.hasArg("segment") ? server.arg("segment").toInt() : -1;
+    if (!eventLogSegment(i, path, sizeof(path)) || !LittleFS.exists(path)) {
+      server.send(404, "application/json", "{\"error\":\"no such segment\"}");
+      return;
+    }
+    File f = LittleFS.open(path, "r");
+    server.streamFile(f, "application/octet-stream");
+    f.close();
+  });
+
+  // Echo trace: ?mode=record|replay|off switches, the reply is the recorder state
+  server.on("/api/trace", HTTP_POST, []() {
+    static const char *const modes[] = {"off", "record", "replay"};
+    String arg = server.arg("mode");
+    int m = 0;
+    while (m < 3 && arg != modes[m]) m++;
+    if (m == 3 || !traceSetMode((TraceMode)m)) {
+      server.send(400, "application/json", "{\"error\":\"cannot switch trace mode\"}");
+      return;
+    }
+    TraceStats t = traceStats();
+    char json[128];
+    JsonWriter w(json, sizeof(json));
+    w.beginObject();
+    w.field("mode", modes[t.mode]);
+    w.field("recorded", t.recorded);
+    w.field("dropped", t.dropped + t.full);
+    w.field("replayed", t.replayed);
+    w.endObject();
+    server.send(200, "application/json", json);
+  });
+
+  // Recorded trace, raw, for program --replay-trace
+  server.on("/api/trace.bin", HTTP_GET, []() {
+    if (!LittleFS.exists(tracePath())) {
+      server.send(404, "application/json", "{\"error\":\"no trace\"}");
+      return;
+    }
+    File f = LittleFS.open(tracePath(), "r");
+    server.streamFile(f, "application/octet-stream");
+    f.close();
+  });
+
+  // Priority requests, served by the controller task's preemption (Preemption.h)
+  server.on("/api/priority", HTTP_POST, []() { sendPriority(CMD_PRIORITY); });
+  server.on("/api/priority/release", HTTP_POST, []() { sendPriority(CMD_RELEASE); });
+
+  // Emergency all-red on/off (useful during demos); it clears through yellow like any preemption
   server.on("/api/toggleAllRed", HTTP_POST, []() {
-    allRedLatched = !allRedLatched;
-    server.send(200, "application/json", "{\"allRed\":" + String(allRedLatched ? "true" : "false") + "}");
+    if (!sendCommand(Command{CMD_TOGGLE_ALL_RED, {}})) {
+      server.send(503, "application/json", "{\"error\":\"busy\"}");
+      return;
+    }
+    server.send(200, "application/json", !status.allRed ? "{\"allRed\":true}" : "{\"allRed\":false}");
+  });
+
+  // Dashboard assets; "/" is index.html
+  staticBegin(server);
+  server.onNotFound([]() {
+    if (staticServe(server)) return;
+    if (server.uri() == "/") server.send(200, "text/plain", "Traffic controller (simulated)");
+    else server.send(404, "text/plain", "Not found");
   });
 
   server.begin();
@@ -185,85 +445,119 @@ void startWebServer() {
 
 void handleWebServer() {
   server.handleClient();
-}
+  if (millis() - lastHeartbeat >= heartbeatInterval) {
+    lastHeartbeat = millis();
+    events.heartbeat();
+  }
 
-void pushLog(const String &msg) {
-  // push to /logs as simple JSON with timestamp
-  String payload = "{";
-  payload += "\"msg\":\"" + msg + "\",";
-  payload += "\"ts\":\"" + getIsoTimestamp() + "\"";
-  payload += "}";
-  if (!firebasePost("logs", payload)) {
-    Serial.println("pushLog: failed (or simulated)");
+#if SIMULATE == 0
+  static WiFiUDP statusUdp;
+  static unsigned long lastMulticast = 0;
+  if (STATUS_MULTICAST_MS && WiFi.status() == WL_CONNECTED && millis() - lastMulticast >= STATUS_MULTICAST_MS) {
+    lastMulticast = millis();
+    uint8_t frame[statusMaxFrame];
+    size_t n = encodeStatus(frame);
+    statusUdp.beginPacket(STATUS_GROUP, STATUS_PORT);
+    statusUdp.write(frame, n);
+    statusUdp.endPacket();
   }
+#endif
 }
 
-// Update traffic-wide status node (currentStep + green times)
-void updateTrafficStatus(int currentStep) {
-  String json = "{";
-  json += "\"currentStep\":" + String(currentStep) + ",";
-  json += "\"greenA\":" + String(greenA) + ",";
-  json += "\"greenB\":" + String(greenB) + ",";
-  json += "\"greenC\":" + String(greenC) + ",";
-  json += "\"allRed\":" + String(allRedLatched ? "true" : "false") + ",";
-  json += "\"ts\":\"" + getIsoTimestamp() + "\"";
-  json += "}";
-  // Put to /status
-  if (!firebasePut("status", json)) {
-    // in SIMULATE mode this will succeed as a print
-    Serial.println("updateTrafficStatus: firebasePut failed or simulated");
+// Update traffic-wide status node (currentStep, green times, cycle length)
+void updateTrafficStatus(const TrafficStatus &st) {
+  bool changed = st.currentStep != status.currentStep || st.allRed != status.allRed || st.cycle != status.cycle ||
+                 st.preempt != status.preempt || st.priorityPending != status.priorityPending;
+  for (int i = 0; i < APPROACHES; i++) changed |= st.lanes[i].green != status.lanes[i].green;
+  status = st;
+
+  // also update public lane greenTimes / colours for /api/status
+  for (int i = 0; i < APPROACHES; i++) {
+    PublicLane &L = publicLanes[i];
+    uint8_t aspect = status.lanes[i].aspect;
+    if (L.greenTime != status.lanes[i].green || L.aspect != aspect) L.dirty = true;
+    L.greenTime = status.lanes[i].green;
+    L.aspect = aspect;
+    L.status = aspectNames[aspect];
   }
 
-  // also update public lane greenTimes for /api/status
-  laneA_public.greenTime = greenA;
-  laneB_public.greenTime = greenB;
-  laneC_public.greenTime = greenC;
+  if (!changed) return;
+
+  char ts[12], json[144 + 24 * APPROACHES];
+  uptimeString(ts, sizeof(ts));
+  JsonWriter w(json, sizeof(json));
+  w.beginObject();
+  w.field("currentStep", status.currentStep);
+  writeGreens(w, status);
+  w.field("ts", (const char *)ts);
+  w.endObject();
+  if (!w.ok()) return;
+  telemetryQueue("status", json);
+  if (!events.size()) return;
+
+  char frame[112 + 24 * APPROACHES];
+  JsonWriter e(frame, sizeof(frame));
+  e.beginObject();
+  e.key("status");
+  e.beginObject();
+  e.field("currentStep", status.currentStep);
+  writeGreens(e, status);
+  e.endObject();
+  e.endObject();
+  if (e.ok()) events.send(frame, e.length());
 }
 
-// Called by trafficController to push lane stats
-void updateLaneData(char lane, int count, float flow, float avgSpeed) {
-  // Update local public copies (so web GET /api/status shows latest)
-  if (lane == 'A' || lane == 'a') {
-    laneA_public.count = count;
-    laneA_public.flow = flow;
-    laneA_public.avgSpeed = avgSpeed;
-    laneA_public.greenTime = greenA;
-    // status can be set here if you want depending on currentStep
-  } else if (lane == 'B' || lane == 'b') {
-    laneB_public.count = count;
-    laneB_public.flow = flow;
-    laneB_public.avgSpeed = avgSpeed;
-    laneB_public.greenTime = greenB;
-  } else if (lane == 'C' || lane == 'c') {
-    laneC_public.count = count;
-    laneC_public.flow = flow;
-    laneC_public.avgSpeed = avgSpeed;
-    laneC_public.greenTime = greenC;
-  } else {
-    Serial.println("updateLaneData: invalid lane char");
+// Called by the network task to push lane stats; unchanged lanes are not re-sent
+void updateLaneData(int i, const LaneSummary &s) {
+  if (i < 0 || i >= APPROACHES) {
+    LOG_ERROR("updateLaneData: invalid lane %d", i);
     return;
   }
 
+  // Update local public copy (so web GET /api/status shows latest)
+  PublicLane &L = publicLanes[i];
+  if (L.count != s.count || L.flow != s.flow || L.avgSpeed != s.avgSpeed || L.queue != s.queue ||
+      L.flow1m != s.rate[WINDOW_1MIN] || L.flow5m != s.rate[WINDOW_5MIN] || L.flow15m != s.rate[WINDOW_15MIN] ||
+      L.speedStdDev != s.speedStdDev)
+    L.dirty = true;
+  L.count = s.count;
+  L.flow = s.flow;
+  L.avgSpeed = s.avgSpeed;
+  L.queue = s.queue;
+  L.flow1m = s.rate[WINDOW_1MIN];
+  L.flow5m = s.rate[WINDOW_5MIN];
+  L.flow15m = s.rate[WINDOW_15MIN];
+  L.speedStdDev = s.speedStdDev;
+  if (!L.dirty) return;
+
   // Build JSON to push to Firebase (or simulate)
-  String json = "{";
-  json += "\"count\":" + String(count) + ",";
-  json += "\"flow\":" + String(flow, 4) + ",";
-  json += "\"avgSpeed\":" + String(avgSpeed, 4) + ",";
-  json += "\"greenTime\":" + String((lane=='A' || lane=='a') ? greenA : lane=='B' || lane=='b' ? greenB : greenC) + ",";
-  // include status if you set it; default to unknown here
-  String statusStr = "unknown";
-  json += "\"status\":\"" + statusStr + "\",";
-  json += "\"updatedAt\":\"" + getIsoTimestamp() + "\"";
-  json += "}";
-
-  String path;
-  if (lane == 'A' || lane == 'a') path = "lanes/laneA";
-  else if (lane == 'B' || lane == 'b') path = "lanes/laneB";
-  else path = "lanes/laneC";
-
-  if (!firebasePut(path, json)) {
-    Serial.println("updateLaneData: firebasePut failed (or simulated)");
-  } else {
-    Serial.printf("updateLaneData: pushed %s\n", path.c_str());
-  }
+  char ts[12], json[224];
+  uptimeString(ts, sizeof(ts));
+  JsonWriter w(json, sizeof(json));
+  w.beginObject();
+  writeLane(w, L);
+  w.field("updatedAt", (const char *)ts);
+  w.endObject();
+  if (!w.ok()) return;
+
+  char path[16];
+  laneKey(path, sizeof(path), "lanes/lane", i);
+  L.dirty = false;
+  telemetryQueue(path, json);
+  if (!events.size()) return;
+
+  // {"lanes":{"laneA":{...}}}
+  char name[8], frame[240];
+  laneKey(name, sizeof(name), "lane", i);
+  JsonWriter e(frame, sizeof(frame));
+  e.beginObject();
+  e.key("lanes");
+  e.beginObject();
+  e.key(name);
+  e.beginObject();
+  writeLane(e, L);
+  e.endObject();
+  e.endObject();
+  e.endObject();
+  if (e.ok()) events.send(frame, e.length());
 }
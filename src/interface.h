@@ -1,18 +1,19 @@
 #pragma once
 
 #include <Arduino.h>
+#include "TrafficLight.h"
+#include "Coordination.h"
 
 // Call from main setup/loop
 void connectWiFi();
 void startWebServer();
 void handleWebServer();
 
-// Called from main loop periodically / from trafficController
-void updateTrafficStatus(int currentStep);
-void pushLog(const String &msg);
+// Called from the network task with the latest controller snapshot
+void updateTrafficStatus(const TrafficStatus &status);
 
-// Called from trafficController to push per-lane stats
-void updateLaneData(char lane, int count, float flow, float avgSpeed);
+// Called from the network task to push approach i's stats from the snapshot
+void updateLaneData(int i, const LaneSummary &lane);
 
-// Optional helper you can call from Serial or elsewhere
-String getIsoTimestamp();
+// UDP transport for corridor coordination; nullptr in simulation mode
+CoordLink *coordinationLink();
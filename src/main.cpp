@@ -4,21 +4,48 @@
 #include "TrafficLight.h"
 #include "Ultrasonic.h"
 #include "interface.h"
+#include "Tasks.h"
+#include "Board.h"
+#include "EventLog.h"
 
-unsigned long prevMillis = 0;
-unsigned long lastUpdate = 0;   // for web refresh
-int currentStep = 0;
-
-unsigned long greenA = 20, greenB = 20, greenC = 20;
+unsigned long greenTime = 20;  // initial green per approach
 unsigned long overlap = 5;
 
 // Adaptive parameters
-const float Kp = 20; 
+const float Kp = 20;
+const float Ki = 0;  // integral gain per update; 0 is proportional-only
 const float s_target = 0.05;
 const float deltamax = 5;
 const unsigned long minGreen = 5, maxGreen = 60;
 
+// Cycle length (Webster): bounds, saturation flow and start-up lost time per green
+const unsigned long minCycle = 40, maxCycle = 120;
+const float saturationFlow = 0.5;  // veh/s, ~2 s headway
+const float startupLost = 2;
+
+// Actuated greens: end after `gap` s without an arrival, extend in `extension` s steps
+const float gap = 3, extension = 2;
+const float vehiclesPerCount = 1.25;  // queued cars merge under the sensor
+
+// Priority requests: all-red time between the last yellow and a priority green
+const float preemptClearance = 2;
+
+// Corridor coordination (Coordination.h): give each controller of a corridor
+// its node number in travel direction and the same corridor id, node count and
+// cycle. One node runs on its own.
+const CoordConfig corridor = {
+    1,      // corridor id
+    0, 1,   // node, nodes
+    0,      // coordinated approach: the one traffic from the upstream node arrives on
+    60, 0,  // s, common cycle and this node's initial offset
+    true,   // adapt the offset to arrivals from upstream
+};
+
+// Lamp pins, driven by the controller task
+static GpioSignalOutput signals;
+
 void setup() {
+  Serial.setTxBufferSize(1024);  // the log task writes only what fits (Log.h)
   Serial.begin(115200);
 
   // Mount LittleFS
@@ -26,44 +53,22 @@ void setup() {
     Serial.println("LittleFS mount failed!");
   }
   Serial.println("LittleFS mounted.");
+  eventLogBegin();
 
   // Connect WiFi + start server
   connectWiFi();
   startWebServer();
 
-  // Traffic light pins
-  pinMode(A_R, OUTPUT); pinMode(A_Y, OUTPUT); pinMode(A_G, OUTPUT);
-  pinMode(B_R, OUTPUT); pinMode(B_Y, OUTPUT); pinMode(B_G, OUTPUT);
-  pinMode(C_R, OUTPUT); pinMode(C_Y, OUTPUT); pinMode(C_G, OUTPUT);
-  digitalWrite(A_R, HIGH); digitalWrite(B_R, HIGH); digitalWrite(C_R, HIGH);
+  // Controller, sensor and network tasks (see Tasks.h); the controller sets
+  // up the lamp pins, every head red
+  ControllerConfig config = {greenTime, overlap,
+                             Kp, Ki, s_target, deltamax, minGreen, maxGreen,
+                             minCycle, maxCycle, saturationFlow, startupLost,
+                             gap, extension, vehiclesPerCount, preemptClearance};
+  startTasks(config, corridor, signals, boardHooks());
 }
 
 void loop() {
-  if (allRedLatched) {
-    return;  // skip normal light sequencing
-  }
-  // Handle light control
-  trafficController(greenA, greenB, greenC, overlap,
-                    currentStep, prevMillis,
-                    greenA, greenB, greenC,
-                    Kp, s_target, deltamax, minGreen, maxGreen);
-
-  // Sensor logic per active step
-  if (currentStep == 0) UltrasonicSensor("U1", sensor1, greenA*1000, 5, 32);
-  if (currentStep == 2) UltrasonicSensor("U2", sensor2, greenB*1000, 23, 18);
-  if (currentStep == 4) UltrasonicSensor("U3", sensor3, greenC*1000, 27, 34);
-
-  // Web server always listening
-  handleWebServer();
-
-  // Update status every 100 ms without blocking
-  unsigned long now = millis();
-  if (now - lastUpdate >= 100) {
-    lastUpdate = now;
-    updateTrafficStatus(currentStep);
-    pushLog("Step: " + String(currentStep));
-    // If you want global stats:
-  }
-
-
+  // Everything runs in the tasks started by setup()
+  vTaskDelete(NULL);
 }
@@ -0,0 +1,88 @@
+#pragma once
+// Host stand-in for the Arduino core used by the simulator (env:sim). Time is
+// virtual and GPIO goes through the simulated HAL in Hal.cpp, so the firmware
+// modules compile and run unmodified.
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "WString.h"
+
+#define IRAM_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+using std::max;
+using std::min;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+inline int digitalPinToInterrupt(int pin) { return pin; }
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+// Byte sink with printf, as the Arduino core's (Metrics.h writes through it)
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buf++);
+    return n;
+  }
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t printf(const char *fmt, ...);
+};
+
+// The CPU cycle counter runs off the virtual clock at a nominal 240 MHz
+class EspClass {
+ public:
+  uint32_t getCycleCount() { return (uint32_t)(micros() * 240UL); }
+  uint32_t getCpuFreqMHz() { return 240; }
+};
+
+extern EspClass ESP;
+
+// Serial output is discarded unless simSerialEcho is set
+class SimSerial {
+ public:
+  void begin(unsigned long) {}
+  int availableForWrite() { return 4096; }
+  size_t print(const char *s) { return out("%s", s); }
+  size_t print(char c) { return out("%c", c); }
+  size_t print(int v) { return out("%d", v); }
+  size_t print(unsigned int v) { return out("%u", v); }
+  size_t print(long v) { return out("%ld", v); }
+  size_t print(unsigned long v) { return out("%lu", v); }
+  size_t print(double v, int digits = 2) { return out("%.*f", digits, v); }
+  template <typename T>
+  size_t println(T v) { return print(v) + print('\n'); }
+  size_t println(double v, int digits) { return print(v, digits) + print('\n'); }
+  size_t println() { return print('\n'); }
+  size_t printf(const char *fmt, ...);
+
+ private:
+  size_t out(const char *fmt, ...);
+};
+
+extern SimSerial Serial;
+extern bool simSerialEcho;
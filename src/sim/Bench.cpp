@@ -0,0 +1,509 @@
+// Controller regression bench: replays fixed traffic scenarios through the
+// firmware controller, measures per-call CPU cost, prints JSON and optionally
+// fails against a baseline file.
+#include "Arduino.h"
+#include "Hal.h"
+#include "Sim.h"
+#include "TrafficLight.h"
+#include "Allocate.h"
+#include "EventStream.h"
+#include "StatusFormat.h"
+#include "Histogram.h"
+#include "Log.h"
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <utility>
+#include <vector>
+
+struct Scenario {
+  const char *name;
+  double hours;
+  ArrivalProfile profile;
+  float rates[3];  // veh/h for lanes A, B, C; repeated for further approaches
+  float noiseCm = 1, dropout = 0;  // detector echo model
+  float preemptEvery = 0;          // s between emergency requests (SimOptions::preemptEvery)
+};
+
+static const Scenario scenarios[] = {
+  {"light", 4, PROFILE_POISSON, {150, 200, 100}},
+  {"heavy", 4, PROFILE_POISSON, {500, 700, 400}},
+  {"uneven", 4, PROFILE_POISSON, {600, 100, 100}},
+  {"platoon", 4, PROFILE_PLATOON, {300, 450, 200}},
+  {"rush", 24, PROFILE_RUSH, {600, 800, 400}},
+  {"noisy", 4, PROFILE_POISSON, {300, 450, 200}, 10, 0.1},
+  {"preempt", 4, PROFILE_POISSON, {300, 450, 200}, 1, 0, 120},
+};
+
+// Controller state is process-global, so every measurement runs in its own child
+template <typename T, typename Fn>
+static bool inChild(T &out, Fn fn) {
+  int fds[2];
+  if (pipe(fds) != 0) return false;
+  pid_t pid = fork();
+  if (pid < 0) return false;
+  if (pid == 0) {
+    close(fds[0]);
+    T value = fn();
+    ssize_t n = write(fds[1], &value, sizeof(value));
+    _exit(n == (ssize_t)sizeof(value) ? 0 : 1);
+  }
+  close(fds[1]);
+  size_t got = 0;
+  while (got < sizeof(out)) {
+    ssize_t n = read(fds[0], (char *)&out + got, sizeof(out) - got);
+    if (n <= 0) break;
+    got += n;
+  }
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return got == sizeof(out) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double nsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Fastest of a few runs: preemption and cache misses only ever add time, so
+// the minimum is the steadiest figure to hold against a baseline
+template <typename Fn>
+static double bestOf(Fn fn) {
+  const int runs = 3;
+  double best = fn();
+  for (int i = 1; i < runs; i++) best = std::min(best, fn());
+  return best;
+}
+
+// Intersection::service() at the firmware's 5 ms service period, with detector
+// totals growing unevenly so every cycle end reallocates
+template <size_t N>
+static double controllerNsPerCall(const PhasePlan<N> &plan, const SimOptions &opt) {
+  const long calls = 2000000;
+  simReset();
+  ControllerConfig config = controllerConfig(opt);
+  Intersection<N> intersection(plan);
+  intersection.begin(config, 0);
+  SensorTotals totals[N] = {};
+  uint32_t x = 12345;
+
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) {
+    simAdvanceTo((uint64_t)i * 5000);
+    x = x * 1664525u + 1013904223u;
+    totals[(x >> 24) % N].vehicles += (x >> 20) & 1;
+    intersection.service(totals, config);
+  }
+  return nsSince(start) / calls;
+}
+
+// Eight approaches served in turn, for the cost-per-approach comparison
+static PhasePlan<8> eightWayPlan() {
+  static PhaseStep<8> steps[16];
+  PhasePlan<8> plan = {};
+  for (int i = 0; i < 8; i++) {
+    plan.heads[i] = SignalHead{(uint8_t)(3 * i), (uint8_t)(3 * i + 1), (uint8_t)(3 * i + 2)};
+    steps[2 * i].timing = i;
+    steps[2 * i + 1].timing = -1;
+    for (int j = 0; j < 8; j++) {
+      steps[2 * i].heads[j] = (j == i) ? ASPECT_GREEN : ASPECT_RED;
+      steps[2 * i + 1].heads[j] = (j == i) ? ASPECT_YELLOW : ASPECT_RED;
+    }
+  }
+  plan.steps = steps;
+  plan.stepCount = 16;
+  return plan;
+}
+
+// One AdaptiveGreen per approach, updated in turn
+static double adjustNsPerCall(const SimOptions &opt) {
+  const long calls = 2000000;
+  volatile unsigned long sink = 0;
+  AdaptiveGreen lanes[APPROACHES];
+  unsigned long green[APPROACHES];
+  for (int i = 0; i < APPROACHES; i++) {
+    lanes[i] = AdaptiveGreen(AdaptiveParams{opt.Kp, opt.Ki, opt.s_target, opt.deltamax, opt.minGreen, opt.maxGreen});
+    green[i] = 20;
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) {
+    int lane = i % APPROACHES;
+    float flow = 0.05f + 0.3f * (i % 97) / 97.0f;
+    float speed = 2.0f + (i % 13);
+    green[lane] = lanes[lane].update(green[lane], flow, speed);
+    sink = sink + green[lane];
+  }
+  return nsSince(start) / calls;
+}
+
+// LaneStats::observe() with one detection (count and speed) per call, a call
+// per simulated second so buckets roll and leave the windows as on the road
+static double laneStatsNsPerDetection() {
+  const long calls = 5000000;
+  LaneStats stats;
+  SensorTotals t;
+  stats.begin(t, 0);
+  uint32_t x = 12345;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) {
+    x = x * 1664525u + 1013904223u;
+    t.vehicles++;
+    t.departures++;
+    t.speedCount++;
+    t.totalSpeed += 3 + (x >> 28);
+    stats.observe(t, (unsigned long)i * 1000, 1.25f, 0.5f);
+  }
+  double ns = nsSince(start) / calls;
+  volatile float sink = stats.rate(WINDOW_1MIN) + stats.speedStdDev();
+  (void)sink;
+  return ns;
+}
+
+// The detection front-end on synthetic echoes: an empty road with noise and
+// lost echoes, and a vehicle passing every 30 samples
+static double detectorNsPerSample() {
+  const long samples = 5000000;
+  simReset();
+  UltrasonicState state;
+  uint32_t x = 12345;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < samples; i++) {
+    simAdvanceTo((uint64_t)i * 100000);
+    x = x * 1664525u + 1013904223u;
+    unsigned long echoUs = (i % 30 >= 22) ? 8746 : 23324;  // 150 / 400 cm
+    echoUs += (long)(x >> 24) - 128;                        // +-2 cm
+    if ((x >> 8) % 20 == 0) echoUs = 0;
+    UltrasonicReplay("bench", state, echoUs);
+  }
+  return nsSince(start) / samples;
+}
+
+// Stands in for a dashboard's socket: copies what it is sent
+struct SinkClient {
+  char *sink = nullptr;
+  size_t write(const uint8_t *data, size_t len) {
+    memcpy(sink, data, len);
+    return len;
+  }
+  bool connected() const { return true; }
+  void stop() {}
+};
+
+// EventStream::send() of a lane update to `clients` subscribers
+static double eventsNsPerFrame(int clients) {
+  const long frames = 1000000;
+  static char sinks[8][512];
+  EventStream<SinkClient, 8> events;
+  for (int i = 0; i < clients; i++) {
+    SinkClient c;
+    c.sink = sinks[i];
+    events.add(c);
+  }
+  char json[200];
+  int len = snprintf(json, sizeof(json),
+                     "{\"lanes\":{\"laneA\":{\"count\":12,\"flow\":0.0833,\"avgSpeed\":4.2500,\"queue\":3.5,"
+                     "\"flow1m\":0.1000,\"flow5m\":0.0900,\"flow15m\":0.0850,\"speedStdDev\":1.2000,"
+                     "\"greenTime\":25,\"status\":\"green\"}}}");
+  volatile long reached = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < frames; i++) {
+    json[30] = '0' + i % 10;
+    reached = reached + events.send(json, len);
+  }
+  return nsSince(start) / frames;
+}
+
+// decodeStatus() on a batch of frames of random lane values
+static double statusDecodeNsPerFrame() {
+  const int batch = 256;
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> unit(0, 1);
+  static uint8_t frames[batch][statusMaxFrame];
+  static LaneSummary sent[batch][APPROACHES];
+  size_t size = sizeof(StatusHeader) + APPROACHES * sizeof(StatusLane);
+  for (int f = 0; f < batch; f++) {
+    StatusHeader h = {statusMagic, statusVersion, sizeof(StatusHeader), sizeof(StatusLane), APPROACHES,
+                      (uint32_t)f, (uint32_t)f * 100, (uint8_t)(f % 6), (uint8_t)(f % 2), 90};
+    memcpy(frames[f], &h, sizeof(h));
+    for (int i = 0; i < APPROACHES; i++) {
+      LaneSummary &L = sent[f][i];
+      L.count = rng() % 100;
+      L.green = rng() % 90;
+      L.flow = unit(rng) * 0.6f;
+      L.avgSpeed = unit(rng) * 20;
+      L.queue = unit(rng) * 40;
+      for (int w = 0; w < WINDOW_COUNT; w++) L.rate[w] = unit(rng) * 0.6f;
+      L.speedStdDev = unit(rng) * 5;
+      StatusLane l = {statusFixed(L.count, 1), statusFixed(L.green, 1), statusFixed(L.flow, statusRateScale),
+                      statusFixed(L.avgSpeed, statusSpeedScale), statusFixed(L.queue, statusQueueScale),
+                      {statusFixed(L.rate[0], statusRateScale), statusFixed(L.rate[1], statusRateScale),
+                       statusFixed(L.rate[2], statusRateScale)},
+                      statusFixed(L.speedStdDev, statusSpeedScale), (uint8_t)(i % 3), 0};
+      memcpy(frames[f] + sizeof(h) + i * sizeof(l), &l, sizeof(l));
+    }
+  }
+
+  StatusValues v;
+  const long frameCount = 5000000;
+  volatile float sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < frameCount; i++) {
+    decodeStatus(frames[i % batch], size, v);
+    sink = sink + v.lane[0].flow;
+  }
+  return nsSince(start) / frameCount;
+}
+
+// LatencyHistogram::record() on log-spread times
+static double histogramNsPerRecord() {
+  const long calls = 20000000;
+  static LatencyHistogram h;
+  uint32_t x = 12345;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) {
+    x = x * 1664525u + 1013904223u;
+    h.record(x >> (8 + (x & 15)));
+  }
+  double ns = nsSince(start) / calls;
+  volatile uint32_t sink = h.counts[x % LatencyHistogram::buckets];
+  (void)sink;
+  return ns;
+}
+
+// Caller side of one three-argument log record; the ring is drained (and
+// formatted, output discarded) outside the timed part
+static double logNsPerRecord() {
+  const long calls = 2000000, batch = 32;
+  double ns = 0;
+  for (long i = 0; i < calls; i += batch) {
+    auto start = std::chrono::steady_clock::now();
+    for (long j = 0; j < batch; j++) logWrite(LOG_LEVEL_INFO, "Lane %c | Flow %.2f | Green: %lus", 'A', 0.25f, i + j);
+    ns += nsSince(start);
+    logFlush();
+  }
+  return ns / calls;
+}
+
+// allocateGreens() for maxAllocLanes lanes, weights changing every call
+static double allocatorNsPerCall() {
+  float w[maxAllocLanes];
+  unsigned long out[maxAllocLanes];
+  const long calls = 1000000;
+  volatile unsigned long sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) {
+    for (size_t j = 0; j < maxAllocLanes; j++) w[j] = (float)((i * 31 + j * 17) % 97);
+    allocateGreens(w, maxAllocLanes, 600, 5, 60, out);
+    sink = sink + out[i % maxAllocLanes];
+  }
+  return nsSince(start) / calls;
+}
+
+// Minimal reader for the bench's own JSON: nested objects of numbers, flattened to "a.b" keys
+static bool readBaseline(const char *path, BenchMetrics &out) {
+  FILE *f = fopen(path, "r");
+  if (!f) return false;
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  fclose(f);
+
+  std::vector<std::string> stack;
+  std::string key;
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == '"') {
+      size_t end = text.find('"', i + 1);
+      if (end == std::string::npos) return false;
+      key = text.substr(i + 1, end - i - 1);
+      i = end;
+    } else if (c == '{') {
+      if (!key.empty()) stack.push_back(key);
+      key.clear();
+    } else if (c == '}') {
+      if (!stack.empty()) stack.pop_back();
+    } else if (c == ':') {
+      size_t j = i + 1;
+      while (j < text.size() && isspace((unsigned char)text[j])) j++;
+      if (j < text.size() && text[j] != '{') {
+        std::string full;
+        for (const std::string &s : stack) full += s + ".";
+        out.push_back(std::make_pair(full + key, strtod(text.c_str() + j, nullptr)));
+      }
+    }
+  }
+  return true;
+}
+
+static bool higherIsBetter(const std::string &key) {
+  return key.find("veh_per_hour") != std::string::npos;
+}
+
+static const char *flagValue(int argc, char **argv, const char *flag) {
+  for (int i = 1; i + 1 < argc; i++)
+    if (!strcmp(argv[i], flag)) return argv[i + 1];
+  return nullptr;
+}
+
+static void add(BenchMetrics &out, const std::string &key, double value) {
+  out.push_back(std::make_pair(key, value));
+}
+
+bool benchScenarios(const SimOptions &base, BenchMetrics &out) {
+  for (const Scenario &sc : scenarios) {
+    SimOptions opt = base;
+    opt.hours = sc.hours;
+    for (int i = 0; i < APPROACHES; i++) opt.demand[i] = LaneDemand{sc.rates[i % 3], sc.profile};
+    opt.noiseCm = sc.noiseCm;
+    opt.dropout = sc.dropout;
+    opt.preemptEvery = sc.preemptEvery;
+
+    SimResult r;
+    if (!inChild(r, [&]() { return runSim(opt); })) {
+      fprintf(stderr, "bench: scenario %s failed\n", sc.name);
+      return false;
+    }
+    if (r.lampViolations) {
+      fprintf(stderr, "bench: scenario %s broke %lu lamp safety invariants\n", sc.name, r.lampViolations);
+      return false;
+    }
+    // An emergency green is due one yellow and one red clearance after the request
+    double latencyBound = opt.overlap + opt.preemptClearance + opt.tickMs / 1000.0;
+    if (sc.preemptEvery > 0 && (!r.preemptions || r.maxPreemptLatency > latencyBound)) {
+      fprintf(stderr, "bench: scenario %s: priority green after %.2f s, bound %.2f s\n", sc.name,
+              r.maxPreemptLatency, latencyBound);
+      return false;
+    }
+    std::string p = std::string("scenarios.") + sc.name + ".";
+    add(out, p + "avg_delay_s", r.avgDelay());
+    add(out, p + "max_queue", (double)r.maxQueue());
+    add(out, p + "veh_per_hour", r.vehPerHour());
+    add(out, p + "stops_per_veh", r.stopsPerVeh());
+    add(out, p + "green_swing_s", r.greenSwing);
+    add(out, p + "count_error", r.countError());
+    if (sc.preemptEvery > 0) {
+      add(out, p + "max_preempt_latency_s", r.maxPreemptLatency);
+      add(out, p + "avg_preempt_latency_s", r.avgPreemptLatency);
+    }
+  }
+  return true;
+}
+
+bool benchCpu(const SimOptions &base, BenchMetrics &out) {
+  static const PhasePlan<8> plan8 = eightWayPlan();
+  double controllerNs = 0, controller8Ns = 0, adjustNs = 0, detectorNs = 0;
+  if (!inChild(controllerNs, [&]() { return bestOf([&]() { return controllerNsPerCall(phasePlan, base); }); }) ||
+      !inChild(controller8Ns, [&]() { return bestOf([&]() { return controllerNsPerCall(plan8, base); }); }) ||
+      !inChild(adjustNs, [&]() { return bestOf([&]() { return adjustNsPerCall(base); }); }) ||
+      !inChild(detectorNs, [&]() { return bestOf(detectorNsPerSample); })) {
+    fprintf(stderr, "bench: cpu measurement failed\n");
+    return false;
+  }
+  double allocNs = bestOf(allocatorNsPerCall);
+  double statsNs = bestOf(laneStatsNsPerDetection);
+  double events1Ns = bestOf([]() { return eventsNsPerFrame(1); });
+  double events8Ns = bestOf([]() { return eventsNsPerFrame(8); });
+  double statusNs = bestOf(statusDecodeNsPerFrame);
+  double histogramNs = bestOf(histogramNsPerRecord);
+  double logNs = bestOf(logNsPerRecord);
+  add(out, "cpu.controller_ns_per_call", controllerNs);
+  add(out, "cpu.controller8_ns_per_call", controller8Ns);
+  add(out, "cpu.adjust_ns_per_call", adjustNs);
+  add(out, "cpu.alloc16_ns_per_call", allocNs);
+  add(out, "cpu.lanestats_ns_per_detection", statsNs);
+  add(out, "cpu.detector_ns_per_sample", detectorNs);
+  add(out, "cpu.events1_ns_per_frame", events1Ns);
+  add(out, "cpu.events8_ns_per_frame", events8Ns);
+  add(out, "cpu.status_decode_ns_per_frame", statusNs);
+  add(out, "cpu.histogram_ns_per_record", histogramNs);
+  add(out, "cpu.log_ns_per_record", logNs);
+  return true;
+}
+
+int benchRegressions(const BenchMetrics &metrics, const char *baselinePath, const char *prefix, double tolerance) {
+  BenchMetrics baseline;
+  if (!readBaseline(baselinePath, baseline)) {
+    fprintf(stderr, "bench: cannot read baseline %s\n", baselinePath);
+    return -1;
+  }
+  // The baseline's own tolerance for the group, unless the caller gives one
+  std::string group = std::string(prefix).substr(0, strcspn(prefix, "."));
+  if (tolerance < 0) {
+    for (const auto &b : baseline)
+      if (b.first == "tolerance." + group) tolerance = b.second;
+    if (tolerance < 0) {
+      fprintf(stderr, "bench: no tolerance for %s in %s\n", group.c_str(), baselinePath);
+      return -1;
+    }
+  }
+
+  int regressions = 0;
+  for (const auto &b : baseline) {
+    if (b.first.compare(0, strlen(prefix), prefix) != 0) continue;
+    const std::pair<std::string, double> *cur = nullptr;
+    for (const auto &m : metrics)
+      if (m.first == b.first) cur = &m;
+    if (!cur) {
+      fprintf(stderr, "MISSING %s\n", b.first.c_str());
+      regressions++;
+      continue;
+    }
+    bool worse = higherIsBetter(b.first) ? cur->second < b.second * (1 - tolerance)
+                                         : cur->second > b.second * (1 + tolerance) + 1e-9;
+    if (worse) {
+      fprintf(stderr, "REGRESSION %s: %.3f (baseline %.3f, tolerance %.2f)\n", b.first.c_str(), cur->second,
+              b.second, tolerance);
+      regressions++;
+    }
+  }
+  return regressions;
+}
+
+// Flat "a.b.c" keys back into nested objects, in order
+static void printJson(const BenchMetrics &metrics) {
+  std::vector<std::string> open;
+  bool first = true;
+  printf("{");
+  for (const auto &m : metrics) {
+    std::vector<std::string> path;
+    size_t start = 0, dot;
+    while ((dot = m.first.find('.', start)) != std::string::npos) {
+      path.push_back(m.first.substr(start, dot - start));
+      start = dot + 1;
+    }
+    size_t common = 0;
+    while (common < open.size() && common < path.size() && open[common] == path[common]) common++;
+    for (; open.size() > common; open.pop_back()) printf("}");
+    for (size_t i = common; i < path.size(); i++, first = true) {
+      printf("%s\"%s\":{", first ? "" : ",", path[i].c_str());
+      first = false;
+      open.push_back(path[i]);
+    }
+    printf("%s\"%s\":%.6g", first ? "" : ",", m.first.c_str() + start, m.second);
+    first = false;
+  }
+  for (; !open.empty(); open.pop_back()) printf("}");
+  printf("}\n");
+}
+
+int runBench(int argc, char **argv) {
+  SimOptions base;
+  parseSimArgs(argc, argv, base);
+  const char *baselinePath = flagValue(argc, argv, "--baseline");
+  const char *tolArg = flagValue(argc, argv, "--tolerance");
+  const char *cpuTolArg = flagValue(argc, argv, "--cpu-tolerance");
+
+  BenchMetrics metrics;
+  if (!benchScenarios(base, metrics) || !benchCpu(base, metrics)) return 1;
+  printJson(metrics);
+  fflush(stdout);
+
+  if (!baselinePath) return 0;
+  int scenarioRegressions = benchRegressions(metrics, baselinePath, "scenarios.", tolArg ? atof(tolArg) : -1);
+  int cpuRegressions = benchRegressions(metrics, baselinePath, "cpu.", cpuTolArg ? atof(cpuTolArg) : -1);
+  return scenarioRegressions || cpuRegressions ? 1 : 0;
+}
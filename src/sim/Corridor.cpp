@@ -0,0 +1,315 @@
+// Corridor mode (Corridor.h) and its launcher: --corridor N forks one process
+// per node, runs them against each other over loopback and prints stops per
+// vehicle along the corridor.
+#include "Arduino.h"
+#include "Hal.h"
+#include "Corridor.h"
+#include <algorithm>
+#include <chrono>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum SimFrameType : uint8_t {
+  SIM_HELLO,    // start-up handshake
+  SIM_COORD,    // a Coordination.h datagram
+  SIM_VEHICLE,  // a Departure, to the next node
+  SIM_BARRIER,  // sender is done with `epoch`
+};
+
+static const uint64_t epochUs = 20000;
+static const int helloTimeoutMs = 30000, barrierTimeoutMs = 10000;
+static const int maxNodes = 16;
+
+static sockaddr_in loopback(unsigned port) {
+  sockaddr_in a = {};
+  a.sin_family = AF_INET;
+  a.sin_port = htons(port);
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  return a;
+}
+
+LoopbackLink::~LoopbackLink() {
+  if (fd >= 0) close(fd);
+}
+
+void LoopbackLink::post(uint8_t type, int to, const void *data, size_t len, uint8_t ready) {
+  SimFrame f = {};
+  len = std::min(len, sizeof(f.payload));
+  f.type = type;
+  f.from = node;
+  f.ready = ready;
+  f.length = len;
+  f.epoch = epoch;
+  f.seq = seq++;
+  if (len) memcpy(f.payload, data, len);
+  sockaddr_in a = loopback(port + to);
+  sendto(fd, &f, offsetof(SimFrame, payload) + len, 0, (sockaddr *)&a, sizeof(a));
+}
+
+bool LoopbackLink::wait(int timeoutMs) {
+  pollfd p = {fd, POLLIN, 0};
+  if (poll(&p, 1, timeoutMs) <= 0) return false;
+  SimFrame f;
+  ssize_t n;
+  while ((n = recv(fd, &f, sizeof(f), MSG_DONTWAIT)) >= 0) {
+    if (n >= (ssize_t)offsetof(SimFrame, payload) && f.from < nodes && f.from != node) held.push_back(f);
+  }
+  return true;
+}
+
+bool LoopbackLink::open(int n, int count, unsigned p) {
+  node = n;
+  nodes = count;
+  port = p;
+  fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in a = loopback(port + node);
+  if (fd < 0 || bind(fd, (sockaddr *)&a, sizeof(a)) != 0) {
+    fprintf(stderr, "corridor: node %d cannot bind port %u\n", node, port + node);
+    return false;
+  }
+
+  // Hello until every node has said it heard from every other. A node already
+  // past this point counts as ready once anything else of it arrives.
+  uint32_t heard = 0, ready = 0, others = ((1u << nodes) - 1) & ~(1u << node);
+  bool told = false;
+  auto start = std::chrono::steady_clock::now();
+  while (!told || ready != others) {
+    bool all = heard == others;
+    for (int i = 0; i < nodes; i++)
+      if (i != node) post(SIM_HELLO, i, nullptr, 0, all);
+    told |= all;
+    wait(50);
+    for (size_t i = 0; i < held.size();) {
+      const SimFrame &f = held[i];
+      heard |= 1u << f.from;
+      if (f.type != SIM_HELLO || f.ready) ready |= 1u << f.from;
+      if (f.type == SIM_HELLO) held.erase(held.begin() + i);
+      else i++;
+    }
+    if (std::chrono::steady_clock::now() - start > std::chrono::milliseconds(helloTimeoutMs)) {
+      fprintf(stderr, "corridor: node %d: not every node came up\n", node);
+      return false;
+    }
+  }
+  return true;
+}
+
+void LoopbackLink::send(uint8_t to, const void *data, size_t len) {
+  if (to < nodes && to != node) post(SIM_COORD, to, data, len);
+}
+
+size_t LoopbackLink::receive(void *buf, size_t size) {
+  if (coordinated.empty()) return 0;
+  const SimFrame &f = coordinated.front();
+  size_t n = std::min((size_t)f.length, size);
+  memcpy(buf, f.payload, n);
+  coordinated.pop_front();
+  return n;
+}
+
+void LoopbackLink::sendVehicle(const Departure &d) {
+  if (node + 1 < nodes) post(SIM_VEHICLE, node + 1, &d, sizeof(d));
+}
+
+bool LoopbackLink::endEpoch() {
+  for (int i = 0; i < nodes; i++)
+    if (i != node) post(SIM_BARRIER, i, nullptr, 0);
+  for (;;) {
+    int barriers = 0;
+    for (const SimFrame &f : held) barriers += f.type == SIM_BARRIER && f.epoch == epoch;
+    if (barriers == nodes - 1) break;
+    if (!wait(barrierTimeoutMs)) {
+      fprintf(stderr, "corridor: node %d: no barrier from every node for epoch %u\n", node, epoch);
+      return false;
+    }
+  }
+
+  // Everything sent in this epoch, in sender order; a faster node's next epoch waits
+  std::vector<SimFrame> due, later;
+  for (const SimFrame &f : held) {
+    if (f.type == SIM_HELLO) continue;
+    (f.epoch == epoch ? due : later).push_back(f);
+  }
+  held.swap(later);
+  std::sort(due.begin(), due.end(),
+            [](const SimFrame &a, const SimFrame &b) { return a.from != b.from ? a.from < b.from : a.seq < b.seq; });
+  vehicles.clear();
+  for (const SimFrame &f : due) {
+    if (f.type == SIM_COORD) {
+      coordinated.push_back(f);
+    } else if (f.type == SIM_VEHICLE && f.length == sizeof(Departure)) {
+      Departure d;
+      memcpy(&d, f.payload, sizeof(d));
+      vehicles.push_back(d);
+    }
+  }
+  epoch++;
+  return true;
+}
+
+bool CorridorNode::begin(const SimOptions &o, LaneTraffic &l) {
+  opt = &o;
+  lane = &l;
+  departed.clear();
+  lane->departures = &departed;
+  rng.seed(o.seed * 7919 + o.node);
+  nextEpoch = epochUs;
+  skew = (uint32_t)(o.node * o.clockSkew);
+  entries = greenAt = 0;
+  throughVehicles = throughStops = 0;
+  throughDelay = 0;
+  if (!link.open(o.node, o.nodes, o.port)) return false;
+
+  CoordConfig c = {1, (uint8_t)o.node, (uint8_t)o.nodes, o.coordLane, o.coordCycle, o.node * o.offsetStep, o.adapt};
+  coordinator.begin(c, o.coordCycle ? &link : nullptr, clock());
+  return true;
+}
+
+bool CorridorNode::tick(uint64_t t, Intersection<APPROACHES> &intersection, const SensorTotals &totals) {
+  if (totals.entries != entries) {
+    entries = totals.entries;
+    coordinator.onArrival(totals.lastEntry + skew);
+  }
+  if (t < nextEpoch) return true;
+  nextEpoch += epochUs;
+
+  // The last node is the end of the corridor
+  for (const Departure &d : departed) {
+    if (opt->node + 1 < opt->nodes) {
+      link.sendVehicle(d);
+    } else {
+      throughVehicles++;
+      throughStops += d.stops;
+      throughDelay += d.delay;
+    }
+  }
+  departed.clear();
+
+  TrafficStatus st;
+  intersection.summary(st);
+  if (st.coordGreenAt != greenAt) {
+    greenAt = st.coordGreenAt;
+    coordinator.onGreen(greenAt + skew, st.lanes[opt->coordLane].green);
+  }
+  coordinator.service(clock());
+  if (!link.endEpoch()) return false;
+
+  std::uniform_real_distribution<double> spread(0.95, 1.05);
+  for (const Departure &d : link.vehicles) lane->inject(d.at + opt->travel * spread(rng), d);
+
+  CoordPlan plan = coordinator.plan(clock());
+  plan.zeroAt -= skew;
+  intersection.coordinate(plan);
+  return true;
+}
+
+void CorridorNode::finish(SimResult &r) {
+  if (opt->node + 1 == opt->nodes)
+    for (const Departure &d : departed) {
+      throughVehicles++;
+      throughStops += d.stops;
+      throughDelay += d.delay;
+    }
+  lane->departures = nullptr;
+
+  CoordStatus s = coordinator.status(clock());
+  r.throughVehicles = throughVehicles;
+  r.throughStops = throughStops;
+  r.throughDelay = throughDelay;
+  r.synced = s.synced;
+  r.clockError = s.synced ? (int32_t)(s.clockOffset + skew) : 0;  // node 0's clock is the simulation's
+  r.offset = s.offsetMs / 1000.0;
+  r.onGreen = s.onGreen;
+  r.offsetShifts = s.shifts;
+}
+
+int runCorridor(int argc, char **argv) {
+  SimOptions opt;
+  parseSimArgs(argc, argv, opt);
+  if (opt.nodes > maxNodes) {
+    fprintf(stderr, "corridor: at most %d nodes\n", maxNodes);
+    return 2;
+  }
+
+  std::vector<pid_t> pids(opt.nodes);
+  std::vector<int> fds(opt.nodes);
+  for (int i = 0; i < opt.nodes; i++) {
+    int p[2];
+    if (pipe(p) != 0 || (pids[i] = fork()) < 0) {
+      fprintf(stderr, "corridor: cannot start node %d\n", i);
+      return 1;
+    }
+    if (pids[i] == 0) {
+      close(p[0]);
+      opt.node = i;
+      SimResult r = runSim(opt);
+      ssize_t n = write(p[1], &r, sizeof(r));
+      _exit(n == (ssize_t)sizeof(r) && !r.corridorFailed ? 0 : 1);
+    }
+    close(p[1]);
+    fds[i] = p[0];
+  }
+
+  std::vector<SimResult> results(opt.nodes);
+  bool ok = true;
+  for (int i = 0; i < opt.nodes; i++) {
+    size_t got = 0;
+    while (got < sizeof(SimResult)) {
+      ssize_t n = read(fds[i], (char *)&results[i] + got, sizeof(SimResult) - got);
+      if (n <= 0) break;
+      got += n;
+    }
+    close(fds[i]);
+    int status = 0;
+    waitpid(pids[i], &status, 0);
+    if (got != sizeof(SimResult) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "corridor: node %d failed\n", i);
+      ok = false;
+    }
+  }
+  if (!ok) return 1;
+
+  const SimResult &last = results.back();
+  double stops = last.throughVehicles ? (double)last.throughStops / last.throughVehicles : 0.0;
+  double delay = last.throughVehicles ? last.throughDelay / last.throughVehicles : 0.0;
+  unsigned long violations = 0;
+  for (const SimResult &r : results) violations += r.lampViolations;
+
+  bool json = false;
+  for (int i = 1; i < argc; i++) json |= !strcmp(argv[i], "--json");
+  if (json) {
+    printf("{\"nodes\":[");
+    for (int i = 0; i < opt.nodes; i++) {
+      const SimResult &r = results[i];
+      const LaneMetrics &m = r.lanes[opt.coordLane];
+      printf("%s{\"arrived\":%lu,\"served\":%lu,\"stops_per_veh\":%.4f,\"avg_delay_s\":%.3f,\"offset_s\":%.0f,"
+             "\"on_green\":%.3f,\"offset_shifts\":%lu,\"synced\":%s,\"clock_error_ms\":%ld,\"lamp_violations\":%lu}",
+             i ? "," : "", m.arrivals, m.departures, m.departures ? (double)m.stops / m.departures : 0.0,
+             m.departures ? m.totalDelay / m.departures : 0.0, r.offset, r.onGreen, r.offsetShifts,
+             r.synced ? "true" : "false", r.clockError, r.lampViolations);
+    }
+    printf("],\"through_vehicles\":%lu,\"stops_per_veh\":%.4f,\"delay_per_veh_s\":%.3f}\n", last.throughVehicles,
+           stops, delay);
+    return violations ? 1 : 0;
+  }
+
+  printf("node  arrived  served  stops/veh  avg_delay_s  offset_s  on_green  shifts  clock_err_ms\n");
+  for (int i = 0; i < opt.nodes; i++) {
+    const SimResult &r = results[i];
+    const LaneMetrics &m = r.lanes[opt.coordLane];
+    char clock[16] = "-";
+    if (r.synced) snprintf(clock, sizeof(clock), "%ld", r.clockError);
+    printf("%4d  %7lu  %6lu  %9.2f  %11.1f  %8.0f  %7.0f%%  %6lu  %12s\n", i, m.arrivals, m.departures,
+           m.departures ? (double)m.stops / m.departures : 0.0, m.departures ? m.totalDelay / m.departures : 0.0,
+           r.offset, r.onGreen * 100, r.offsetShifts, clock);
+  }
+  printf("corridor: %lu vehicles through %d intersections, %.2f stops/veh, %.1f s delay/veh\n",
+         last.throughVehicles, opt.nodes, stops, delay);
+  printf("lamps: %lu safety violations\n", violations);
+  return violations ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "Sim.h"
+#include "Coordination.h"
+#include <deque>
+#include <random>
+#include <vector>
+
+// Corridor mode: one simulator process per intersection, nodes 0 .. n-1 in
+// travel direction, talking UDP on loopback (port + node). Besides the
+// coordination datagrams (Coordination.h) the sockets carry the road: a
+// vehicle leaving node i's coordinated approach reaches node i + 1's
+// detector --travel s later (+-5%), with the stops and delay it has had.
+//
+// The processes run in lockstep. Each ends every 20 ms epoch of simulated
+// time with a barrier datagram to all the others and waits for theirs.
+// Datagrams are delivered at the end of the epoch they were sent in, sorted by
+// sender, so runs are deterministic and a datagram takes the same time each way.
+
+struct SimFrame {
+  uint8_t type;    // SimFrameType
+  uint8_t from;
+  uint8_t ready;   // SIM_HELLO: sender has heard from every node
+  uint8_t length;  // payload bytes
+  uint32_t epoch;
+  uint32_t seq;
+  uint8_t payload[56];
+};
+
+class LoopbackLink : public CoordLink {
+ public:
+  ~LoopbackLink();
+
+  // Binds 127.0.0.1:port + node and waits (up to 30 s) until every node is up
+  bool open(int node, int nodes, unsigned port);
+
+  void send(uint8_t to, const void *data, size_t len) override;
+  size_t receive(void *buf, size_t size) override;
+
+  // To the next node; arrives with the next endEpoch() there
+  void sendVehicle(const Departure &d);
+
+  // Barrier with every node, then hands out what was sent in this epoch;
+  // false when a node stays silent for 10 s
+  bool endEpoch();
+
+  std::vector<Departure> vehicles;  // delivered by the last endEpoch()
+
+ private:
+  void post(uint8_t type, int to, const void *data, size_t len, uint8_t ready = 0);
+  bool wait(int timeoutMs);  // reads whatever arrives into `held`
+
+  int fd = -1;
+  int node = 0, nodes = 0;
+  unsigned port = 0;
+  uint32_t epoch = 0, seq = 0;
+  std::vector<SimFrame> held;       // received, for this epoch or the next
+  std::deque<SimFrame> coordinated;  // COORD datagrams for receive()
+};
+
+// The corridor side of one runSim(): coordination, the barrier and the
+// vehicles handed on. Node i's clock runs i * --clock-skew ms ahead of the
+// simulation's, so the clock sync has something to correct.
+class CorridorNode {
+ public:
+  bool begin(const SimOptions &opt, LaneTraffic &lane);
+
+  // Every tick before the controller's service(), with the detector totals of
+  // the coordinated approach; false when the corridor broke down
+  bool tick(uint64_t t, Intersection<APPROACHES> &intersection, const SensorTotals &totals);
+
+  void finish(SimResult &r);
+
+ private:
+  uint32_t clock() const { return millis() + skew; }
+
+  const SimOptions *opt = nullptr;
+  LaneTraffic *lane = nullptr;
+  LoopbackLink link;
+  Coordinator coordinator;
+  std::vector<Departure> departed;
+  std::mt19937_64 rng;
+  uint64_t nextEpoch = 0;
+  uint32_t skew = 0;
+  unsigned long entries = 0, greenAt = 0;
+  unsigned long throughVehicles = 0, throughStops = 0;
+  double throughDelay = 0;
+};
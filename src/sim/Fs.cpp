@@ -0,0 +1,38 @@
+#include "LittleFS.h"
+#include <sys/stat.h>
+
+LittleFSFS LittleFS;
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath) {
+  struct stat st;
+  if (stat(basePath, &st) != 0 && !(formatOnFail && ::mkdir(basePath, 0755) == 0)) return false;
+  snprintf(root, sizeof(root), "%s", basePath);
+  return true;
+}
+
+void LittleFSFS::hostPath(const char *path, char *buf, size_t size) {
+  snprintf(buf, size, "%s%s", root, path);
+}
+
+bool LittleFSFS::exists(const char *path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  struct stat st;
+  return stat(host, &st) == 0;
+}
+
+bool LittleFSFS::mkdir(const char *path) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  return ::mkdir(host, 0755) == 0;
+}
+
+// Binary either way; "w" truncates, as on the target
+File LittleFSFS::open(const char *path, const char *mode) {
+  char host[512];
+  hostPath(path, host, sizeof(host));
+  struct stat st;
+  if (stat(host, &st) == 0 && S_ISDIR(st.st_mode)) return File();
+  FILE *f = fopen(host, !strcmp(mode, "w") ? "wb" : !strcmp(mode, "a") ? "ab" : "rb");
+  return f ? File(f) : File();
+}
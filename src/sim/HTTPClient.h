@@ -0,0 +1,36 @@
+#pragma once
+// Host stand-in for the ESP32 HTTPClient, enough for Telemetry.cpp: HTTP/1.1
+// PATCH to an http://host:port/path URL over POSIX sockets, with keep-alive
+// (setReuse), a connect timeout and a response timeout. Error codes follow
+// the original's (negative: no HTTP status).
+#include "WiFi.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+class HTTPClient {
+ public:
+  bool begin(WiFiClient &client, const char *url);
+  void addHeader(const char *name, const char *value);
+  void setReuse(bool reuse) { this->reuse = reuse; }
+  void setConnectTimeout(int32_t ms) { connectTimeout = ms; }
+  void setTimeout(uint16_t ms) { timeout = ms; }
+  int PATCH(uint8_t *payload, size_t size);
+  void end();  // closes the socket unless it is kept alive
+
+ private:
+  bool connect();
+  int readResponse();
+
+  WiFiClient *client = nullptr;
+  char host[64] = "";
+  uint16_t port = 80;
+  char path[128] = "/";
+  char headers[256] = "";
+  bool reuse = false, keepAlive = false;
+  int32_t connectTimeout = 5000;
+  uint16_t timeout = 5000;
+};
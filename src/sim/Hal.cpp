@@ -0,0 +1,117 @@
+#include "Arduino.h"
+#include "Hal.h"
+#include <atomic>
+#include <queue>
+#include <vector>
+
+SimSerial Serial;
+bool simSerialEcho = false;
+EspClass ESP;
+
+struct Edge {
+  uint64_t at;
+  uint64_t seq;  // keeps edges at the same instant in schedule order
+  uint8_t pin;
+  uint8_t level;
+  bool operator>(const Edge &o) const { return at != o.at ? at > o.at : seq > o.seq; }
+};
+
+struct Isr {
+  void (*fn)(void *);
+  void *arg;
+};
+
+static const int numPins = 64;
+static std::atomic<uint64_t> nowUs{0};  // read by any task, advanced by one thread
+static uint64_t edgeSeq = 0;
+static uint8_t levels[numPins];
+static Isr isrs[numPins];
+static std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge>> edges;
+static SimTriggerHook triggerHook = nullptr;
+static void *triggerCtx = nullptr;
+
+uint64_t simMicros() { return nowUs; }
+
+void simAdvanceTo(uint64_t us) {
+  while (!edges.empty() && edges.top().at <= us) {
+    Edge e = edges.top();
+    edges.pop();
+    if (e.at > nowUs) nowUs = e.at;
+    if (levels[e.pin] == e.level) continue;
+    levels[e.pin] = e.level;
+    if (isrs[e.pin].fn) isrs[e.pin].fn(isrs[e.pin].arg);
+  }
+  if (us > nowUs) nowUs = us;
+}
+
+void simScheduleEdge(uint64_t at, uint8_t pin, uint8_t level) {
+  edges.push(Edge{at, edgeSeq++, pin, level});
+}
+
+uint8_t simPinLevel(uint8_t pin) { return pin < numPins ? levels[pin] : LOW; }
+
+void simOnTrigger(SimTriggerHook hook, void *ctx) {
+  triggerHook = hook;
+  triggerCtx = ctx;
+}
+
+void simReset() {
+  nowUs = 0;
+  edgeSeq = 0;
+  memset(levels, 0, sizeof(levels));
+  memset(isrs, 0, sizeof(isrs));
+  edges = decltype(edges)();
+}
+
+// ---- Arduino API on top of the virtual clock ----
+unsigned long millis() { return (unsigned long)(nowUs / 1000); }
+unsigned long micros() { return (unsigned long)nowUs; }
+void delay(unsigned long ms) { simAdvanceTo(nowUs + ms * 1000ULL); }
+void delayMicroseconds(unsigned int us) { simAdvanceTo(nowUs + us); }
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= numPins) return;
+  bool falling = levels[pin] == HIGH && val == LOW;
+  levels[pin] = val;
+  if (falling && triggerHook) triggerHook(pin, nowUs, triggerCtx);
+}
+
+int digitalRead(uint8_t pin) { return simPinLevel(pin); }
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int) {
+  if (pin < numPins) isrs[pin] = Isr{isr, arg};
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < numPins) isrs[pin] = Isr{nullptr, nullptr};
+}
+
+size_t SimSerial::out(const char *fmt, ...) {
+  if (!simSerialEcho) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  return n > 0 ? n : 0;
+}
+
+size_t SimSerial::printf(const char *fmt, ...) {
+  if (!simSerialEcho) return 0;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vfprintf(stderr, fmt, ap);
+  va_end(ap);
+  return n > 0 ? n : 0;
+}
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t *)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stdint.h>
+
+// Simulator side of the virtual HAL: a microsecond clock and an ordered queue
+// of input edges. Edges are applied (and their ISRs run) as the clock passes them.
+// The clock may be read from any thread while one thread advances it.
+
+uint64_t simMicros();
+void simAdvanceTo(uint64_t us);
+
+void simScheduleEdge(uint64_t at, uint8_t pin, uint8_t level);
+uint8_t simPinLevel(uint8_t pin);
+
+// Called when an output pin goes HIGH -> LOW (end of a trigger pulse)
+typedef void (*SimTriggerHook)(uint8_t pin, uint64_t at, void *ctx);
+void simOnTrigger(SimTriggerHook hook, void *ctx);
+
+void simReset();
@@ -0,0 +1,67 @@
+#include "Arduino.h"
+#include "Hal.h"
+#include "Lamps.h"
+
+LampRecorder::LampRecorder(const PhasePlan<APPROACHES> &plan) : plan(plan) {
+  for (int a = 0; a < APPROACHES; a++)
+    for (int b = 0; b < APPROACHES; b++) {
+      conflict[a][b] = a != b;
+      for (uint8_t s = 0; s < plan.stepCount; s++)
+        if (plan.steps[s].heads[a] == ASPECT_GREEN && plan.steps[s].heads[b] == ASPECT_GREEN) conflict[a][b] = false;
+    }
+}
+
+void LampRecorder::begin(LampMask) {
+  lit = 0;
+  changes.clear();
+  violations = 0;
+}
+
+int LampRecorder::aspectOf(LampMask m, int lane) const {
+  const SignalHead &h = plan.heads[lane];
+  bool r = m & lampBit(h.red), y = m & lampBit(h.yellow), g = m & lampBit(h.green);
+  if (r + y + g != 1) return -1;
+  return r ? ASPECT_RED : y ? ASPECT_YELLOW : ASPECT_GREEN;
+}
+
+void LampRecorder::violation(const char *what, int a, int b) {
+  if (violations++ >= 10) return;
+  if (b < 0) fprintf(stderr, "sim: lamp safety at %.3f s: %s (%c)\n", simMicros() / 1e6, what, 'A' + a);
+  else fprintf(stderr, "sim: lamp safety at %.3f s: %s (%c, %c)\n", simMicros() / 1e6, what, 'A' + a, 'A' + b);
+}
+
+void LampRecorder::apply(LampMask on, LampMask off) {
+  LampMask next = (lit | on) & ~off;
+  changes.push_back(LampChange{simMicros(), on, off});
+
+  for (int i = 0; i < APPROACHES; i++) {
+    int before = aspectOf(lit, i), after = aspectOf(next, i);
+    if (after < 0) violation("head not showing exactly one aspect", i, -1);
+    if (before == ASPECT_GREEN && after == ASPECT_RED) violation("green ended without yellow", i, -1);
+    for (int j = i + 1; j < APPROACHES; j++)
+      if (conflict[i][j] && after == ASPECT_GREEN && aspectOf(next, j) == ASPECT_GREEN)
+        violation("conflicting greens", i, j);
+  }
+  lit = next;
+}
+
+bool LampRecorder::allRed() const {
+  for (int i = 0; i < APPROACHES; i++)
+    if (aspectOf(lit, i) != ASPECT_RED) return false;
+  return true;
+}
+
+void LampRecorder::writeCsv(FILE *f) const {
+  static const char *const names[] = {"red", "yellow", "green"};
+  fprintf(f, "time_ms,lane,aspect\n");
+  LampMask m = 0;
+  for (const LampChange &c : changes) {
+    LampMask next = (m | c.on) & ~c.off;
+    for (int i = 0; i < APPROACHES; i++) {
+      int a = aspectOf(next, i);
+      if (a != aspectOf(m, i) || !m)
+        fprintf(f, "%.3f,%c,%s\n", c.atUs / 1000.0, 'A' + i, a < 0 ? "invalid" : names[a]);
+    }
+    m = next;
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "TrafficLight.h"
+#include <stdio.h>
+#include <vector>
+
+struct LampChange {
+  uint64_t atUs;
+  LampMask on, off;
+};
+
+// Simulator lamp output: records every batched change with its time and checks
+// the signal safety invariants after each one:
+//  - every head shows exactly one aspect
+//  - approaches that never share a green step in the plan are never green together
+//  - a green ends through yellow
+class LampRecorder : public SignalOutput {
+ public:
+  explicit LampRecorder(const PhasePlan<APPROACHES> &plan);
+
+  void begin(LampMask pins) override;
+  void apply(LampMask on, LampMask off) override;
+
+  bool green(int lane) const { return lit & lampBit(plan.heads[lane].green); }
+  bool allRed() const;
+
+  // time_ms,lane,aspect for every head change
+  void writeCsv(FILE *f) const;
+
+  LampMask lit = 0;
+  std::vector<LampChange> changes;
+  unsigned long violations = 0;
+
+ private:
+  int aspectOf(LampMask m, int lane) const;  // Aspect, or -1 dark / several lit
+  void violation(const char *what, int a, int b);
+
+  const PhasePlan<APPROACHES> &plan;
+  bool conflict[APPROACHES][APPROACHES];
+};
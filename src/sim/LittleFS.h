@@ -0,0 +1,40 @@
+#pragma once
+// Host stand-in for the ESP32 LittleFS library: the filesystem is a host
+// directory (begin()'s basePath), and a File is a stdio stream (Fs.cpp).
+// Enough for EventLog.cpp; a path the host can't open gives a closed File,
+// as a full or damaged flash would.
+#include "Arduino.h"
+#include <memory>
+#include <stdio.h>
+
+class File {
+ public:
+  File() {}
+  explicit File(FILE *f) : stream(f, fclose) {}
+
+  explicit operator bool() const { return (bool)stream; }
+  size_t write(const uint8_t *buf, size_t size) { return stream ? fwrite(buf, 1, size, stream.get()) : 0; }
+  size_t read(uint8_t *buf, size_t size) { return stream ? fread(buf, 1, size, stream.get()) : 0; }
+  void flush() {
+    if (stream) fflush(stream.get());
+  }
+  void close() { stream.reset(); }
+
+ private:
+  std::shared_ptr<FILE> stream;
+};
+
+class LittleFSFS {
+ public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs");
+  bool exists(const char *path);
+  bool mkdir(const char *path);
+  File open(const char *path, const char *mode = "r");
+
+ private:
+  void hostPath(const char *path, char *buf, size_t size);
+
+  char root[256] = "";
+};
+
+extern LittleFSFS LittleFS;
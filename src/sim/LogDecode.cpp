@@ -0,0 +1,82 @@
+// Host decoder for the firmware's event log (LogFormat.h): reads segment files
+// pulled from /api/log, orders them by sequence and prints one CSV row per
+// event with absolute times.
+#include "Arduino.h"
+#include "Sim.h"
+#include "LogFormat.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+struct Segment {
+  std::string path;
+  LogSegmentHeader header;
+};
+
+static bool readHeader(const char *path, LogSegmentHeader &h) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  bool ok = fread(&h, sizeof(h), 1, f) == 1;
+  fclose(f);
+  return ok && h.magic == logMagic && h.version == logVersion && h.recordSize == sizeof(LogRecord);
+}
+
+static void decodeSegment(const Segment &s) {
+  FILE *f = fopen(s.path.c_str(), "rb");
+  if (!f) return;
+  fseek(f, sizeof(LogSegmentHeader), SEEK_SET);
+
+  uint32_t seq = s.header.sequence;
+  uint32_t t = s.header.startMs;
+  LogRecord r;
+  while (fread(&r, sizeof(r), 1, f) == 1) {  // a torn last record is dropped
+    if (r.type == LOG_TIME) {
+      t = r.v[0] | (uint32_t)r.v[1] << 16;
+      continue;
+    }
+    t += r.dtMs;
+    switch (r.type) {
+      case LOG_STEP:
+        printf("%u,%u,step,,%u,%u,%u,,,,,,,,\n", seq, t, r.v[0], r.v[1], r.v[2]);
+        break;
+      case LOG_DETECTION:
+        printf("%u,%u,detection,%c,,,,%.2f,%u,%u,,,,,\n", seq, t, 'A' + r.lane, r.v[0] / 100.0, r.v[1], r.v[2]);
+        break;
+      case LOG_CYCLE:
+        printf("%u,%u,cycle,%c,,,,%.2f,,,%u,%u,%u,,\n", seq, t, 'A' + r.lane, r.v[2] / 100.0, r.v[0], r.v[1], r.v[3]);
+        break;
+      case LOG_PREEMPT: {
+        static const char *const phases[] = {"none", "clear", "all_red", "serve"};
+        char lane[4] = "all";
+        if (r.lane != 0xff) snprintf(lane, sizeof(lane), "%c", 'A' + r.lane);
+        printf("%u,%u,preempt,%s,,,,,,,,,,%s,%u\n", seq, t, lane, r.v[0] < 4 ? phases[r.v[0]] : "?",
+               r.v[0] == PREEMPT_SERVE ? r.v[1] : 0);
+        break;
+      }
+      default:
+        fprintf(stderr, "decode-log: %s: unknown record type %u\n", s.path.c_str(), r.type);
+    }
+  }
+  fclose(f);
+}
+
+int runDecodeLog(int argc, char **argv) {
+  std::vector<Segment> segments;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--decode-log")) continue;
+    Segment s;
+    s.path = argv[i];
+    if (!readHeader(argv[i], s.header)) {
+      fprintf(stderr, "decode-log: %s is not an event log segment\n", argv[i]);
+      continue;
+    }
+    segments.push_back(s);
+  }
+  if (segments.empty()) return 1;
+  std::sort(segments.begin(), segments.end(),
+            [](const Segment &a, const Segment &b) { return a.header.sequence < b.header.sequence; });
+
+  printf("segment,time_ms,event,lane,step,cycle_s,all_red,speed_mps,vehicles,green,count,flow_vph,green_s,preempt,latency_ms\n");
+  for (const Segment &s : segments) decodeSegment(s);
+  return 0;
+}
@@ -0,0 +1,176 @@
+#include "HTTPClient.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+bool WiFiClient::connected() {
+  if (fd < 0) return false;
+  pollfd p = {fd, POLLIN, 0};
+  if (poll(&p, 1, 0) <= 0) return true;
+  // Readable while idle: either stray bytes or the peer's close
+  char c;
+  return recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) > 0;
+}
+
+void WiFiClient::stop() {
+  if (fd >= 0) close(fd);
+  fd = -1;
+}
+
+// Wall-clock ms; the sockets don't run on the virtual clock
+static long long nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// Waits for `events` on fd until `deadline` (nowMs()); false on timeout or error
+static bool waitFor(int fd, short events, long long deadline) {
+  for (;;) {
+    long long left = deadline - nowMs();
+    if (left <= 0) return false;
+    pollfd p = {fd, events, 0};
+    int n = poll(&p, 1, (int)left);
+    if (n > 0) return true;
+    if (n == 0 || errno != EINTR) return false;
+  }
+}
+
+bool HTTPClient::begin(WiFiClient &c, const char *url) {
+  const char *p = strstr(url, "://");
+  p = p ? p + 3 : url;
+  size_t hostLen = strcspn(p, ":/");
+  if (hostLen == 0 || hostLen >= sizeof(host)) return false;
+  char newHost[sizeof(host)];
+  memcpy(newHost, p, hostLen);
+  newHost[hostLen] = 0;
+  p += hostLen;
+  uint16_t newPort = 80;
+  if (*p == ':') newPort = (uint16_t)strtoul(p + 1, (char **)&p, 10);
+
+  // A kept-alive connection only carries on to the same server
+  if (client && (client != &c || strcmp(host, newHost) != 0 || port != newPort)) client->stop();
+  client = &c;
+  strcpy(host, newHost);
+  port = newPort;
+  snprintf(path, sizeof(path), "%s", *p ? p : "/");
+  headers[0] = 0;
+  return true;
+}
+
+void HTTPClient::addHeader(const char *name, const char *value) {
+  size_t n = strlen(headers);
+  snprintf(headers + n, sizeof(headers) - n, "%s: %s\r\n", name, value);
+}
+
+// Non-blocking connect bounded by connectTimeout, then blocking sends bounded by timeout
+bool HTTPClient::connect() {
+  addrinfo hints = {}, *addr = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &addr) != 0) return false;
+
+  int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  bool ok = fd >= 0;
+  if (ok) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    ok = ::connect(fd, addr->ai_addr, addr->ai_addrlen) == 0 ||
+         (errno == EINPROGRESS && waitFor(fd, POLLOUT, nowMs() + connectTimeout));
+  }
+  freeaddrinfo(addr);
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (ok) ok = getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+  if (!ok) {
+    if (fd >= 0) close(fd);
+    return false;
+  }
+
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  timeval tv = {timeout / 1000, (timeout % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  client->fd = fd;
+  return true;
+}
+
+int HTTPClient::PATCH(uint8_t *payload, size_t size) {
+  if (!client) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!client->connected()) {
+    client->stop();
+    if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+
+  char head[512];
+  int n = snprintf(head, sizeof(head),
+                   "PATCH %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\nContent-Length: %zu\r\n%s\r\n", path, host,
+                   reuse ? "keep-alive" : "close", size, headers);
+  if (send(client->fd, head, n, MSG_NOSIGNAL) != n ||
+      send(client->fd, payload, size, MSG_NOSIGNAL) != (ssize_t)size) {
+    client->stop();
+    return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+  }
+  return readResponse();
+}
+
+// Status line and headers, then the body by Content-Length, all within `timeout`
+int HTTPClient::readResponse() {
+  long long deadline = nowMs() + timeout;
+  char buf[2048];
+  size_t have = 0;
+  char *body = nullptr;
+  while (!body) {
+    if (have == sizeof(buf) - 1 || !waitFor(client->fd, POLLIN, deadline)) {
+      client->stop();
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    ssize_t got = recv(client->fd, buf + have, sizeof(buf) - 1 - have, 0);
+    if (got <= 0) {
+      client->stop();
+      return HTTPC_ERROR_CONNECTION_LOST;
+    }
+    have += got;
+    buf[have] = 0;
+    body = strstr(buf, "\r\n\r\n");
+  }
+  body += 4;
+
+  int code = 0;
+  if (sscanf(buf, "HTTP/1.%*d %d", &code) != 1) code = HTTPC_ERROR_CONNECTION_LOST;
+  for (char *c = buf; c < body; c++) *c = tolower(*c);
+  const char *lengthAt = strstr(buf, "content-length:");
+  size_t length = lengthAt ? strtoul(lengthAt + 15, nullptr, 10) : 0;
+  keepAlive = reuse && !strstr(buf, "connection: close");
+
+  // Drain the body so the next request on this connection starts clean
+  size_t bodyHave = have - (body - buf);
+  while (bodyHave < length) {
+    if (!waitFor(client->fd, POLLIN, deadline)) {
+      client->stop();
+      return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    ssize_t got = recv(client->fd, buf, std::min(sizeof(buf), length - bodyHave), 0);
+    if (got <= 0) {
+      client->stop();
+      return HTTPC_ERROR_CONNECTION_LOST;
+    }
+    bodyHave += got;
+  }
+  return code;
+}
+
+void HTTPClient::end() {
+  if (client && !keepAlive) client->stop();
+}
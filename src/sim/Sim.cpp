@@ -0,0 +1,321 @@
+#include "Arduino.h"
+#include "Hal.h"
+#include "Sim.h"
+#include "TrafficLight.h"
+#include "TraceFormat.h"
+#include "Lamps.h"
+#include "Log.h"
+#include "Corridor.h"
+#include <chrono>
+
+static const char *const sensorNames[] = {"U1", "U2", "U3", "U4", "U5", "U6", "U7", "U8"};
+static LaneTraffic lanes[APPROACHES];
+static UltrasonicState sensors[APPROACHES];
+
+// HC-SR04 model: echo goes high ~450 us after the trigger and stays high for
+// the round trip (58 us/cm), or 38 ms when nothing comes back.
+static void onTrigger(uint8_t pin, uint64_t at, void *) {
+  for (int i = 0; i < APPROACHES; i++) {
+    if (pin != detectorPins[i].trig) continue;
+    float d = lanes[i].echoDistance(at / 1e6);
+    uint64_t rise = at + 450;
+    uint64_t width = (d < 0 || d > 450) ? 38000 : (uint64_t)(d * 58.3f);
+    simScheduleEdge(rise, detectorPins[i].echo, HIGH);
+    simScheduleEdge(rise + width, detectorPins[i].echo, LOW);
+  }
+}
+
+// --record-trace: UltrasonicState::tap, ctx = approach index
+static FILE *traceOut = nullptr;
+
+static void recordEcho(void *ctx, unsigned long atMs, unsigned long echoUs) {
+  TraceSample s = {(uint32_t)atMs, traceEcho(echoUs), (uint8_t)(uintptr_t)ctx, 0};
+  fwrite(&s, sizeof(s), 1, traceOut);
+}
+
+// --replay-trace: samples in file order, timed from the start of the recording
+struct TraceReader {
+  FILE *f = nullptr;
+  TraceSample next;
+  bool more = false;
+  uint32_t startMs = 0;
+
+  bool open(const char *path) {
+    TraceHeader h;
+    f = fopen(path, "rb");
+    if (!f || fread(&h, sizeof(h), 1, f) != 1 || h.magic != traceMagic || h.sampleSize != sizeof(TraceSample))
+      return false;
+    startMs = h.startMs;
+    advance();
+    return true;
+  }
+  void advance() { more = fread(&next, sizeof(next), 1, f) == 1; }
+  uint64_t nextUs() const { return (uint64_t)(next.atMs - startMs) * 1000; }
+};
+
+SimResult runSim(const SimOptions &opt) {
+  simReset();
+  simOnTrigger(onTrigger, nullptr);
+  // In a corridor, traffic on the coordinated approach past node 0 comes from upstream
+  bool inCorridor = opt.nodes > 1 && opt.node >= 0;
+  for (int i = 0; i < APPROACHES; i++) {
+    LaneDemand demand = opt.demand[i];
+    if (inCorridor && opt.node > 0 && i == opt.coordLane) demand.rate = 0;
+    lanes[i].begin(demand, opt.seed * APPROACHES + i, opt.noiseCm, opt.dropout);
+  }
+
+  ControllerConfig config = controllerConfig(opt);
+  Intersection<APPROACHES> intersection(phasePlan);
+  LampRecorder lamps(phasePlan);
+  intersection.attach(&lamps);
+  intersection.begin(config, 0);
+  bool green[APPROACHES] = {};
+
+  SimResult r = {};
+  CorridorNode corridor;
+  if (inCorridor && !corridor.begin(opt, lanes[opt.coordLane])) {
+    r.corridorFailed = true;
+    return r;
+  }
+  unsigned long lastGreens[APPROACHES];
+  for (int i = 0; i < APPROACHES; i++) lastGreens[i] = intersection.green[i];
+  double swing = 0;
+  uint64_t cycleStart = 0, cycleTotal = 0;
+  unsigned long entries[APPROACHES] = {};
+
+  // --preempt-every: one request outstanding at a time, its latency measured at the lamps
+  PriorityRequest priority = {};
+  bool waiting = false;
+  unsigned long injected = 0;
+  uint64_t nextPreempt = (uint64_t)(opt.preemptEvery * 1e6);
+  double latencyTotal = 0;
+
+  TraceReader replay;
+  if (opt.replayTrace && !replay.open(opt.replayTrace))
+    fprintf(stderr, "sim: cannot read trace %s\n", opt.replayTrace);
+  if (opt.recordTrace && (traceOut = fopen(opt.recordTrace, "wb"))) {
+    TraceHeader h = {traceMagic, traceVersion, APPROACHES, sizeof(TraceSample), 0, 0};
+    fwrite(&h, sizeof(h), 1, traceOut);
+    for (int i = 0; i < APPROACHES; i++) {
+      sensors[i].tap = recordEcho;
+      sensors[i].tapCtx = (void *)(uintptr_t)i;
+    }
+  }
+
+  const uint64_t tickUs = opt.tickMs * 1000ULL;
+  const uint64_t endUs = (uint64_t)(opt.hours * 3600e6);
+  auto wallStart = std::chrono::steady_clock::now();
+
+  uint64_t t = tickUs;
+  for (; opt.replayTrace ? replay.more : t <= endUs; t += tickUs) {
+    // Replayed echoes are applied at their recorded times, so millis() in
+    // the detector matches the field unit's
+    while (replay.more && replay.nextUs() <= t) {
+      simAdvanceTo(replay.nextUs());
+      if (replay.next.sensor < APPROACHES)
+        UltrasonicReplay(sensorNames[replay.next.sensor], sensors[replay.next.sensor], replay.next.echoUs);
+      replay.advance();
+    }
+    simAdvanceTo(t);
+    if (!opt.replayTrace)
+      for (int i = 0; i < APPROACHES; i++) lanes[i].advance((t - tickUs) / 1e6, t / 1e6, green[i]);
+
+    SensorFrame frame;
+    for (int i = 0; i < APPROACHES; i++) {
+      sensors[i].green = intersection.isGreen(i);
+      if (!opt.replayTrace) UltrasonicSensor(sensorNames[i], sensors[i], detectorPins[i].trig, detectorPins[i].echo);
+      frame.lanes[i] = sensors[i].totals;
+      if (frame.lanes[i].entries != entries[i]) {
+        entries[i] = frame.lanes[i].entries;
+        intersection.onDetection(i, frame.lanes[i].lastEntry);
+      }
+    }
+
+    if (opt.preemptEvery > 0 && !waiting && t >= nextPreempt) {
+      int8_t lane = injected++ % (APPROACHES + 1);
+      priority = PriorityRequest{opt.preemptClass, lane < APPROACHES ? lane : priorityAllRed, millis(),
+                                 (unsigned long)(opt.preemptHold * 1000)};
+      waiting = intersection.request(priority);
+      nextPreempt = t + (uint64_t)(opt.preemptEvery * 1e6);
+    }
+
+    if (inCorridor && !corridor.tick(t, intersection, frame.lanes[opt.coordLane])) {
+      r.corridorFailed = true;
+      break;
+    }
+
+    int stepBefore = intersection.step;
+    intersection.service(frame.lanes, config);
+    for (int i = 0; i < APPROACHES; i++) green[i] = lamps.green(i);
+
+    if (waiting && (priority.lane == priorityAllRed ? lamps.allRed() : lamps.green(priority.lane))) {
+      double latency = (millis() - priority.at) / 1000.0;
+      r.maxPreemptLatency = std::max(r.maxPreemptLatency, latency);
+      latencyTotal += latency;
+      r.preemptions++;
+      waiting = false;
+    }
+
+    if (stepBefore != 0 && intersection.step == 0) {
+      for (int i = 0; i < APPROACHES; i++) {
+        swing += labs((long)intersection.green[i] - (long)lastGreens[i]);
+        lastGreens[i] = intersection.green[i];
+      }
+      cycleTotal += t - cycleStart;
+      cycleStart = t;
+      r.cycles++;
+    }
+    logFlush();  // stands in for the firmware's log task
+  }
+
+  r.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  r.simSeconds = (t - tickUs) / 1e6;
+  if (replay.f) fclose(replay.f);
+  if (traceOut) {
+    fclose(traceOut);
+    traceOut = nullptr;
+  }
+  r.greenSwing = r.cycles ? swing / ((double)APPROACHES * r.cycles) : 0.0;
+  r.avgPreemptLatency = r.preemptions ? latencyTotal / r.preemptions : 0.0;
+  r.avgCycle = r.cycles ? cycleTotal / 1e6 / r.cycles : 0.0;
+  r.gapOuts = intersection.gapOuts;
+  r.maxOuts = intersection.maxOuts;
+  r.lampChanges = lamps.changes.size();
+  r.lampViolations = lamps.violations;
+  if (opt.lampLog) {
+    FILE *f = fopen(opt.lampLog, "w");
+    if (f) {
+      lamps.writeCsv(f);
+      fclose(f);
+    } else fprintf(stderr, "sim: cannot write %s\n", opt.lampLog);
+  }
+  for (int i = 0; i < APPROACHES; i++) {
+    r.lanes[i] = lanes[i].metrics;
+    r.detected[i] = sensors[i].totals.vehicles;
+  }
+  if (inCorridor) corridor.finish(r);
+  return r;
+}
+
+ControllerConfig controllerConfig(const SimOptions &opt) {
+  return ControllerConfig{20, opt.overlap, opt.Kp, opt.Ki, opt.s_target, opt.deltamax, opt.minGreen, opt.maxGreen,
+                          opt.minCycle, opt.maxCycle, opt.saturationFlow, opt.startupLost,
+                          opt.gap, opt.extension, opt.vehiclesPerCount, opt.preemptClearance};
+}
+
+unsigned long SimResult::served() const {
+  unsigned long n = 0;
+  for (const LaneMetrics &m : lanes) n += m.departures;
+  return n;
+}
+
+double SimResult::avgDelay() const {
+  unsigned long n = served();
+  double delay = 0;
+  for (const LaneMetrics &m : lanes) delay += m.totalDelay;
+  return n ? delay / n : 0.0;
+}
+
+double SimResult::vehPerHour() const {
+  return simSeconds > 0 ? served() * 3600.0 / simSeconds : 0.0;
+}
+
+double SimResult::stopsPerVeh() const {
+  unsigned long n = served();
+  unsigned long stops = 0;
+  for (const LaneMetrics &m : lanes) stops += m.stops;
+  return n ? (double)stops / n : 0.0;
+}
+
+size_t SimResult::maxQueue() const {
+  size_t q = 0;
+  for (const LaneMetrics &m : lanes) q = std::max(q, m.maxQueue);
+  return q;
+}
+
+double SimResult::countError() const {
+  unsigned long arrived = 0;
+  double error = 0;
+  for (int i = 0; i < APPROACHES; i++) {
+    arrived += lanes[i].arrivals;
+    error += fabs((double)detected[i] - (double)lanes[i].arrivals);
+  }
+  return arrived ? error / arrived : 0.0;
+}
+
+static bool parseProfile(const char *s, ArrivalProfile &p) {
+  if (!strcmp(s, "poisson")) p = PROFILE_POISSON;
+  else if (!strcmp(s, "platoon")) p = PROFILE_PLATOON;
+  else if (!strcmp(s, "rush")) p = PROFILE_RUSH;
+  else return false;
+  return true;
+}
+
+bool parseSimArgs(int argc, char **argv, SimOptions &o) {
+  for (int i = 1; i < argc; i++) {
+    const char *a = argv[i];
+    const char *v = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (strncmp(a, "--", 2) != 0) return false;
+    if (!strcmp(a, "--verbose") || !strcmp(a, "--json") || !strcmp(a, "--bench") || !strcmp(a, "--tune")) continue;
+    if (!strcmp(a, "--adapt")) {
+      o.adapt = true;
+      continue;
+    }
+    if (!v) return false;
+    i++;
+    if (!strcmp(a, "--hours")) o.hours = atof(v);
+    else if (!strcmp(a, "--seed")) o.seed = strtoull(v, nullptr, 10);
+    else if (!strcmp(a, "--tick-ms")) o.tickMs = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--rates")) {
+      const char *p = v;
+      for (int l = 0; l < APPROACHES; l++) {
+        char *end;
+        o.demand[l].rate = strtof(p, &end);
+        if (end == p || *end != (l + 1 < APPROACHES ? ',' : '\0')) return false;
+        p = end + 1;
+      }
+    } else if (!strcmp(a, "--profile")) {
+      ArrivalProfile p;
+      if (!parseProfile(v, p)) return false;
+      for (LaneDemand &d : o.demand) d.profile = p;
+    }
+    else if (!strcmp(a, "--min-green")) o.minGreen = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--max-green")) o.maxGreen = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--overlap")) o.overlap = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--min-cycle")) o.minCycle = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--max-cycle")) o.maxCycle = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--gap")) o.gap = atof(v);
+    else if (!strcmp(a, "--extension")) o.extension = atof(v);
+    else if (!strcmp(a, "--vehicles-per-count")) o.vehiclesPerCount = atof(v);
+    else if (!strcmp(a, "--kp")) o.Kp = atof(v);
+    else if (!strcmp(a, "--ki")) o.Ki = atof(v);
+    else if (!strcmp(a, "--s-target")) o.s_target = atof(v);
+    else if (!strcmp(a, "--deltamax")) o.deltamax = atof(v);
+    else if (!strcmp(a, "--noise")) o.noiseCm = atof(v);
+    else if (!strcmp(a, "--dropout")) o.dropout = atof(v);
+    else if (!strcmp(a, "--preempt-every")) o.preemptEvery = atof(v);
+    else if (!strcmp(a, "--preempt-hold")) o.preemptHold = atof(v);
+    else if (!strcmp(a, "--preempt-clearance")) o.preemptClearance = atof(v);
+    else if (!strcmp(a, "--preempt-class")) {
+      if (!strcmp(v, "emergency")) o.preemptClass = PRIORITY_EMERGENCY;
+      else if (!strcmp(v, "transit")) o.preemptClass = PRIORITY_TRANSIT;
+      else return false;
+    }
+    else if (!strcmp(a, "--lamp-log")) o.lampLog = v;
+    else if (!strcmp(a, "--record-trace")) o.recordTrace = v;
+    else if (!strcmp(a, "--replay-trace")) o.replayTrace = v;
+    else if (!strcmp(a, "--corridor")) o.nodes = atoi(v);
+    else if (!strcmp(a, "--node")) o.node = atoi(v);
+    else if (!strcmp(a, "--port")) o.port = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--travel")) o.travel = atof(v);
+    else if (!strcmp(a, "--coord-cycle")) o.coordCycle = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--offset")) o.offsetStep = strtoul(v, nullptr, 10);
+    else if (!strcmp(a, "--clock-skew")) o.clockSkew = atol(v);
+    else if (!strcmp(a, "--baseline") || !strcmp(a, "--tolerance") || !strcmp(a, "--cpu-tolerance"))
+      continue;  // bench-only flags
+    else if (!strcmp(a, "--param") || !strcmp(a, "--grid") || !strcmp(a, "--candidates") || !strcmp(a, "--jobs"))
+      continue;  // tuner-only flags
+    else return false;
+  }
+  return o.tickMs > 0 && o.hours > 0 && o.node < o.nodes && o.coordLane < APPROACHES;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "Traffic.h"
+#include "TrafficLight.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SimOptions {
+  double hours = 1;
+  uint64_t seed = 1;
+  unsigned long tickMs = 5;  // controller/sensor service period, as in Tasks.cpp
+  LaneDemand demand[APPROACHES];  // default 300/450/200 veh/h Poisson, repeated past three lanes
+  unsigned long minGreen = 5, maxGreen = 60, overlap = 5;
+  unsigned long minCycle = 40, maxCycle = 120;
+  float saturationFlow = 0.5, startupLost = 2;  // matches the lane model's discharge
+  float gap = 3, extension = 2;                 // --gap 0 runs fixed-time
+  float vehiclesPerCount = 1.25;
+  float Kp = 20, Ki = 0, s_target = 0.05, deltamax = 5;
+  float noiseCm = 1.0, dropout = 0;
+  float preemptClearance = 2;
+  float preemptEvery = 0;  // s between priority requests for A, B, ... then all red, in turn; 0: none
+  float preemptHold = 15;  // s each is held once its target shows
+  PriorityClass preemptClass = PRIORITY_EMERGENCY;
+  const char *recordTrace = nullptr;  // write every echo as a field trace (TraceFormat.h)
+  const char *replayTrace = nullptr;  // detectors read this trace instead of the lane model, to its end
+  const char *lampLog = nullptr;      // every lamp change as CSV
+  // --corridor N: N coordinated nodes, one process each (Corridor.h)
+  int node = -1, nodes = 0;
+  unsigned port = 47800;           // node i listens on port + i
+  float travel = 40;               // s, coordinated approach of node i to that of node i + 1
+  unsigned long coordCycle = 60;   // s, common cycle; 0: every node runs free
+  unsigned long offsetStep = 0;    // s, node i starts at offset i * offsetStep
+  bool adapt = false;              // adapt offsets to measured arrivals
+  long clockSkew = 1500;           // ms, node i's clock starts i * clockSkew ahead
+  uint8_t coordLane = 0;
+
+  SimOptions() {
+    static const float rates[3] = {300, 450, 200};
+    for (int i = 0; i < APPROACHES; i++) demand[i] = LaneDemand{rates[i % 3], PROFILE_POISSON};
+  }
+};
+
+struct SimResult {
+  LaneMetrics lanes[APPROACHES];
+  unsigned long detected[APPROACHES];
+  double simSeconds;
+  double wallSeconds;
+  unsigned long cycles;
+  double avgCycle;    // s, measured
+  unsigned long gapOuts, maxOuts;
+  unsigned long lampChanges, lampViolations;  // batched output writes, safety invariant breaches
+  double greenSwing;  // mean |green change| per lane per cycle, s
+  unsigned long preemptions;             // injected requests that reached their target
+  double maxPreemptLatency, avgPreemptLatency;  // s, request to the lamps showing it
+  // Corridor node; through* are counted on the last node, from node 0's approach on
+  bool corridorFailed;                   // lost another node
+  unsigned long throughVehicles, throughStops;
+  double throughDelay;                   // s, summed over the whole corridor
+  bool synced;
+  long clockError;                       // ms, synced clock - corridor clock
+  double offset;                         // s, final
+  float onGreen;                         // share of profiled arrivals in the coordinated green
+  unsigned long offsetShifts;
+
+  unsigned long served() const;
+  double avgDelay() const;     // s per served vehicle
+  double vehPerHour() const;
+  double stopsPerVeh() const;
+  size_t maxQueue() const;
+  double countError() const;   // sum |detected - arrived| / arrived, over lanes
+};
+
+// Runs the firmware controller and detectors against the lane model. Controller
+// state is process-global, so run one simulation per process (see Bench.cpp).
+SimResult runSim(const SimOptions &opt);
+
+bool parseSimArgs(int argc, char **argv, SimOptions &opt);
+
+// Controller settings for a run, as main.cpp builds them on the target
+ControllerConfig controllerConfig(const SimOptions &opt);
+
+// --bench mode: fixed scenarios + per-call CPU cost, JSON on stdout
+int runBench(int argc, char **argv);
+
+// Bench results keyed "scenarios.light.avg_delay_s", "cpu.controller_ns_per_call", ...
+typedef std::vector<std::pair<std::string, double>> BenchMetrics;
+
+// The fixed scenarios, each in a child process; false on a failed run, a lamp
+// safety breach or a late priority green
+bool benchScenarios(const SimOptions &base, BenchMetrics &out);
+
+// Per-call CPU cost, the fastest of three runs each; false if a measurement failed
+bool benchCpu(const SimOptions &base, BenchMetrics &out);
+
+// Baseline entries under `prefix` ("scenarios." or "cpu.") that `metrics` is
+// worse on by more than `tolerance`, reported on stderr. A negative tolerance
+// takes the baseline's own ("tolerance.scenarios", "tolerance.cpu"). -1 if the
+// baseline can't be read.
+int benchRegressions(const BenchMetrics &metrics, const char *baselinePath, const char *prefix, double tolerance);
+
+// --tune mode: parameter sweep over all cores, Pareto-optimal settings as JSON on stdout
+int runTune(int argc, char **argv);
+
+// --decode-log FILE...: firmware event log segments to CSV on stdout
+int runDecodeLog(int argc, char **argv);
+
+// --corridor N: N nodes as processes over loopback, stops per vehicle along the corridor
+int runCorridor(int argc, char **argv);
+
+// --decode-status FILE...: compact status frames to CSV on stdout
+int runDecodeStatus(int argc, char **argv);
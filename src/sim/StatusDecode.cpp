@@ -0,0 +1,52 @@
+// Host decoder for compact status frames (StatusFormat.h): reads files of one
+// or more concatenated frames, as saved from /api/status.bin or captured from
+// the multicast group, and prints one CSV row per lane per frame.
+#include "Arduino.h"
+#include "Sim.h"
+#include "StatusFormat.h"
+#include <vector>
+
+static bool readFile(const char *path, std::vector<uint8_t> &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+int runDecodeStatus(int argc, char **argv) {
+  static const char *const aspects[] = {"red", "yellow", "green"};
+  int bad = 0;
+  printf("sequence,uptime_ms,step,all_red,preempt,cycle_s,lane,aspect,count,green_s,flow_vph,avg_speed_mps,queue,"
+         "flow1m_vph,flow5m_vph,flow15m_vph,speed_sd_mps\n");
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--decode-status")) continue;
+    std::vector<uint8_t> data;
+      if (!readFile(argv[i], data)) {
+      fprintf(stderr, "decode-status: cannot read %s\n", argv[i]);
+      bad++;
+      continue;
+    }
+    size_t at = 0;
+    while (at < data.size()) {
+      StatusValues v;
+      size_t n = decodeStatus(data.data() + at, data.size() - at, v);
+      if (!n) {
+        fprintf(stderr, "decode-status: %s: bad frame at byte %zu\n", argv[i], at);
+        bad++;
+        break;
+      }
+      for (int l = 0; l < v.lanes; l++) {
+        const StatusLaneValues &L = v.lane[l];
+        printf("%u,%u,%u,%d,%d,%u,%c,%s,%u,%u,%.1f,%.2f,%.1f,%.1f,%.1f,%.1f,%.2f\n", v.sequence, v.uptimeMs, v.step,
+               v.allRed, v.preempt, v.cycle, 'A' + l, L.aspect < 3 ? aspects[L.aspect] : "?", L.count, L.green,
+               L.flow * 3600, L.avgSpeed, L.queue, L.rate[0] * 3600, L.rate[1] * 3600, L.rate[2] * 3600,
+               L.speedStdDev);
+      }
+      at += n;
+    }
+  }
+  return bad ? 1 : 0;
+}
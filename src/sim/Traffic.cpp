@@ -0,0 +1,136 @@
+#include "Traffic.h"
+#include <math.h>
+
+static const double vehicleLength = 4.5;  // m
+static const double satHeadway = 2.0;     // s per discharged vehicle (1800 veh/h)
+static const double startupLost = 2.0;    // s at the start of each green
+static const double stopThreshold = 1.0;  // s of delay that counts as a stop
+static const float roadDistance = 400;    // cm, empty lane under the sensor
+static const float carDistance = 150;     // cm, vehicle roof
+
+void LaneTraffic::begin(const LaneDemand &d, uint64_t seed, float noise, float drop) {
+  demand = d;
+  rng.seed(seed);
+  noiseCm = noise;
+  dropout = drop;
+  metrics = LaneMetrics();
+  pendingArrival = -1;
+  platoonLeft = 0;
+  upcoming.clear();
+  waiting.clear();
+  occupying.clear();
+  wasGreen = false;
+  nextDischarge = 0;
+}
+
+static double rushFactor(double t) {
+  double h = fmod(t / 3600.0, 24.0);
+  return 0.2 + 0.8 * exp(-(h - 8) * (h - 8) / 2) + 0.8 * exp(-(h - 17.5) * (h - 17.5) / 2);
+}
+
+double LaneTraffic::nextArrival(double t) {
+  std::uniform_real_distribution<double> uni(0.0, 1.0);
+  double perSec = demand.rate / 3600.0;
+  if (perSec <= 0) return INFINITY;
+
+  switch (demand.profile) {
+    case PROFILE_PLATOON: {
+      if (platoonLeft > 0) {
+        platoonLeft--;
+        return t + 1.5 + uni(rng);
+      }
+      std::uniform_int_distribution<int> size(2, 8);
+      platoonLeft = size(rng) - 1;
+      std::exponential_distribution<double> gap(perSec / 5.0);
+      return t + gap(rng);
+    }
+    case PROFILE_RUSH: {
+      // Thinning against the peak rate (rushFactor peaks at ~1.0)
+      std::exponential_distribution<double> gap(perSec);
+      for (;;) {
+        t += gap(rng);
+        if (uni(rng) <= rushFactor(t)) return t;
+      }
+    }
+    case PROFILE_POISSON:
+    default: {
+      std::exponential_distribution<double> gap(perSec);
+      return t + gap(rng);
+    }
+  }
+}
+
+// In arrival order: injected vehicles may already be queued past a generated one
+void LaneTraffic::add(const Vehicle &v) {
+  auto u = upcoming.end();
+  while (u != upcoming.begin() && (u - 1)->arrival > v.arrival) --u;
+  upcoming.insert(u, v);
+  auto o = occupying.end();
+  while (o != occupying.begin() && (o - 1)->arrival > v.arrival) --o;
+  occupying.insert(o, v);
+}
+
+void LaneTraffic::generateUntil(double t) {
+  if (pendingArrival < 0) pendingArrival = nextArrival(0);
+  while (pendingArrival <= t) {
+    std::uniform_real_distribution<double> speed(3.0, 8.0);
+    add(Vehicle{pendingArrival, pendingArrival + vehicleLength / speed(rng), 0, 0});
+    pendingArrival = nextArrival(pendingArrival);
+  }
+}
+
+void LaneTraffic::inject(double arrival, const Departure &from) {
+  std::uniform_real_distribution<double> speed(3.0, 8.0);
+  add(Vehicle{arrival, arrival + vehicleLength / speed(rng), from.stops, from.delay});
+}
+
+void LaneTraffic::advance(double from, double to, bool green) {
+  generateUntil(to);
+  while (!upcoming.empty() && upcoming.front().arrival <= to) {
+    waiting.push_back(upcoming.front());
+    upcoming.pop_front();
+    metrics.arrivals++;
+  }
+
+  if (green && !wasGreen && nextDischarge < from + startupLost) nextDischarge = from + startupLost;
+  wasGreen = green;
+
+  if (green) {
+    while (!waiting.empty()) {
+      const Vehicle &v = waiting.front();
+      double depart = v.arrival > nextDischarge ? v.arrival : nextDischarge;
+      if (depart > to) break;
+      double delay = depart - v.arrival;
+      bool stopped = delay > stopThreshold;
+      metrics.totalDelay += delay;
+      if (stopped) metrics.stops++;
+      metrics.departures++;
+      if (departures) departures->push_back(Departure{depart, v.stops + stopped, v.delay + delay});
+      nextDischarge = depart + satHeadway;
+      waiting.pop_front();
+    }
+  }
+  if (waiting.size() > metrics.maxQueue) metrics.maxQueue = waiting.size();
+}
+
+float LaneTraffic::echoDistance(double t) {
+  generateUntil(t);
+  while (!occupying.empty() && occupying.front().leaves < t) occupying.pop_front();
+
+  std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+  if (dropout > 0 && uni(rng) < dropout) return -1;
+
+  float d = roadDistance;
+  for (const Vehicle &v : occupying) {
+    if (v.arrival > t) break;
+    if (v.leaves >= t) {
+      d = carDistance;
+      break;
+    }
+  }
+  if (noiseCm > 0) {
+    std::normal_distribution<float> noise(0.0f, noiseCm);
+    d += noise(rng);
+  }
+  return d;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <random>
+#include <vector>
+
+// Stochastic demand and queue model for one approach. Times are seconds of
+// simulated time. The detector sits upstream of the stop line, so every
+// vehicle passes under it on arrival; departures discharge from the stop-line
+// queue at saturation flow while the lane's green lamp is lit.
+
+enum ArrivalProfile {
+  PROFILE_POISSON,  // constant-rate Poisson arrivals
+  PROFILE_PLATOON,  // Poisson platoons of 2..8 vehicles at ~2 s headway
+  PROFILE_RUSH,     // Poisson with a morning and evening peak (time of day)
+};
+
+struct LaneDemand {
+  float rate;  // mean vehicles/hour (peak-hour rate for PROFILE_RUSH)
+  ArrivalProfile profile;
+};
+
+struct LaneMetrics {
+  unsigned long arrivals = 0;
+  unsigned long departures = 0;
+  unsigned long stops = 0;  // departures that had to wait
+  double totalDelay = 0;    // s, summed over departed vehicles
+  size_t maxQueue = 0;
+};
+
+// A vehicle leaving the stop line, with what it met on the way so far
+// (corridor mode hands it on to the next intersection, sim/Corridor.cpp)
+struct Departure {
+  double at;       // s
+  uint32_t stops;  // this intersection included
+  double delay;    // s
+};
+
+class LaneTraffic {
+ public:
+  void begin(const LaneDemand &demand, uint64_t seed, float noiseCm, float dropout);
+
+  // Arrivals and discharges in (from, to]; green is the lamp state over that interval
+  void advance(double from, double to, bool green);
+
+  // Echo the detector would see at time t: distance in cm, or < 0 for a lost echo
+  float echoDistance(double t);
+
+  // A vehicle from upstream reaching the detector at `arrival` (in the
+  // future), carrying its stops and delay
+  void inject(double arrival, const Departure &from);
+
+  size_t queue() const { return waiting.size(); }
+  LaneMetrics metrics;
+  std::vector<Departure> *departures = nullptr;  // when set, every departure is appended
+
+ private:
+  struct Vehicle {
+    double arrival;
+    double leaves;  // end of detector occupancy
+    uint32_t stops;  // at earlier intersections
+    double delay;
+  };
+
+  double nextArrival(double t);
+  void generateUntil(double t);
+  void add(const Vehicle &v);
+
+  LaneDemand demand;
+  std::mt19937_64 rng;
+  float noiseCm = 0;
+  float dropout = 0;
+
+  double pendingArrival = -1;
+  int platoonLeft = 0;
+
+  std::deque<Vehicle> upcoming;   // generated, not yet at the stop line
+  std::deque<Vehicle> waiting;    // queued at the stop line
+  std::deque<Vehicle> occupying;  // possibly under the detector
+  bool wasGreen = false;
+  double nextDischarge = 0;
+};
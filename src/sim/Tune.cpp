@@ -0,0 +1,233 @@
+// Parameter sweep tuner: runs the controller over a grid or a random sample of
+// settings, on every core, and prints the Pareto-optimal ones. Each candidate
+// is a fresh simulation in its own process (controller, detector and HAL
+// state is process-global), handed out one at a time to whichever worker
+// slot frees up first, so uneven run times never leave a core idle.
+#include "Arduino.h"
+#include "Sim.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct TuneParam {
+  const char *name;  // as the matching run flag, without "--"
+  bool integer;
+  void (*set)(SimOptions &, double);
+  double (*get)(const SimOptions &);
+};
+
+#define TUNE_PARAM(flag, field, integer, type)                                        \
+  { flag, integer, [](SimOptions &o, double v) { o.field = (type)v; },                 \
+    [](const SimOptions &o) { return (double)o.field; } }
+
+static const TuneParam tuneParams[] = {
+  TUNE_PARAM("min-green", minGreen, true, unsigned long),
+  TUNE_PARAM("max-green", maxGreen, true, unsigned long),
+  TUNE_PARAM("min-cycle", minCycle, true, unsigned long),
+  TUNE_PARAM("max-cycle", maxCycle, true, unsigned long),
+  TUNE_PARAM("gap", gap, false, float),
+  TUNE_PARAM("extension", extension, false, float),
+  TUNE_PARAM("vehicles-per-count", vehiclesPerCount, false, float),
+  TUNE_PARAM("kp", Kp, false, float),
+  TUNE_PARAM("ki", Ki, false, float),
+  TUNE_PARAM("s-target", s_target, false, float),
+  TUNE_PARAM("deltamax", deltamax, false, float),
+};
+
+struct TuneRange {
+  const TuneParam *param;
+  double lo, hi;
+};
+
+// Lower is better on every objective
+struct TuneScore {
+  double delay;  // s/veh
+  double stops;  // per vehicle
+  double queue;  // max vehicles
+  double vehPerHour;
+  int ok;
+};
+
+static const TuneParam *findParam(const char *name, size_t len) {
+  for (const TuneParam &p : tuneParams)
+    if (strlen(p.name) == len && !strncmp(p.name, name, len)) return &p;
+  return nullptr;
+}
+
+// "name=lo:hi"
+static bool parseRange(const char *s, TuneRange &r) {
+  const char *eq = strchr(s, '=');
+  if (!eq || !(r.param = findParam(s, eq - s))) return false;
+  char *end;
+  r.lo = strtod(eq + 1, &end);
+  if (*end != ':') return false;
+  r.hi = strtod(end + 1, &end);
+  return *end == '\0' && r.lo <= r.hi;
+}
+
+static bool valid(const SimOptions &o) {
+  return o.minGreen <= o.maxGreen && o.minCycle <= o.maxCycle && o.gap >= 0 && o.extension >= 0 &&
+         o.vehiclesPerCount > 0 && o.deltamax >= 0;
+}
+
+static void setParam(SimOptions &o, const TuneRange &r, double v) {
+  r.param->set(o, r.param->integer ? floor(v + 0.5) : v);
+}
+
+static bool dominates(const TuneScore &a, const TuneScore &b) {
+  return a.delay <= b.delay && a.stops <= b.stops && a.queue <= b.queue &&
+         (a.delay < b.delay || a.stops < b.stops || a.queue < b.queue);
+}
+
+static void runCandidate(const SimOptions &opt, TuneScore &out) {
+  SimResult r = runSim(opt);
+  out.delay = r.avgDelay();
+  out.stops = r.stopsPerVeh();
+  out.queue = (double)r.maxQueue();
+  out.vehPerHour = r.vehPerHour();
+  out.ok = 1;
+}
+
+int runTune(int argc, char **argv) {
+  SimOptions base;
+  parseSimArgs(argc, argv, base);  // traffic and the settings that are not swept, per candidate
+
+  std::vector<TuneRange> ranges;
+  long grid = 0, count = 200, jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  for (int i = 1; i + 1 < argc; i++) {
+    const char *a = argv[i], *v = argv[i + 1];
+    if (!strcmp(a, "--param")) {
+      TuneRange r;
+      if (!parseRange(v, r)) {
+        fprintf(stderr, "tune: bad --param %s (name=lo:hi)\n", v);
+        return 2;
+      }
+      ranges.push_back(r);
+    } else if (!strcmp(a, "--grid")) grid = atol(v);
+    else if (!strcmp(a, "--candidates")) count = atol(v);
+    else if (!strcmp(a, "--jobs")) jobs = atol(v);
+  }
+  if (ranges.empty()) {
+    static const char *const defaults[] = {"min-green=3:10", "max-green=30:90", "max-cycle=60:150",
+                                           "gap=1:5", "extension=1:4"};
+    for (const char *d : defaults) {
+      TuneRange r;
+      parseRange(d, r);
+      ranges.push_back(r);
+    }
+  }
+  if (jobs < 1) jobs = 1;
+
+  // Candidates: every grid point, or a uniform sample seeded by --seed
+  std::vector<SimOptions> candidates;
+  if (grid > 1) {
+    std::vector<long> idx(ranges.size(), 0);
+    for (;;) {
+      SimOptions o = base;
+      for (size_t d = 0; d < ranges.size(); d++)
+        setParam(o, ranges[d], ranges[d].lo + (ranges[d].hi - ranges[d].lo) * idx[d] / (grid - 1));
+      if (valid(o)) candidates.push_back(o);
+      size_t d = 0;
+      while (d < ranges.size() && ++idx[d] == grid) idx[d++] = 0;
+      if (d == ranges.size()) break;
+    }
+  } else {
+    std::mt19937_64 rng(base.seed);
+    std::uniform_real_distribution<double> unit(0, 1);
+    // Invalid draws are redrawn, up to 100 per candidate: ranges that never
+    // give a valid setting end the sweep below instead of spinning
+    long draws = 0;
+    for (; (long)candidates.size() < count && draws < 100 * count; draws++) {
+      SimOptions o = base;
+      for (const TuneRange &r : ranges) setParam(o, r, r.lo + (r.hi - r.lo) * unit(rng));
+      if (valid(o)) candidates.push_back(o);
+    }
+    if (!candidates.empty() && (long)candidates.size() < count)
+      fprintf(stderr, "tune: only %zu valid candidates in %ld draws\n", candidates.size(), draws);
+  }
+  size_t n = candidates.size();
+  if (n == 0) {
+    fprintf(stderr, "tune: no valid candidates\n");
+    return 2;
+  }
+
+  TuneScore *scores = (TuneScore *)mmap(nullptr, n * sizeof(TuneScore), PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (scores == MAP_FAILED) {
+    perror("tune: mmap");
+    return 1;
+  }
+  memset(scores, 0, n * sizeof(TuneScore));
+
+  // Process pool: the next candidate goes to whichever slot frees up first
+  fflush(stdout);
+  auto wallStart = std::chrono::steady_clock::now();
+  size_t next = 0, done = 0;
+  long running = 0;
+  while (done < n) {
+    if (running < jobs && next < n) {
+      pid_t pid = fork();
+      if (pid == 0) {
+        runCandidate(candidates[next], scores[next]);
+        _exit(0);
+      }
+      if (pid < 0) {
+        perror("tune: fork");
+        break;
+      }
+      next++;
+      running++;
+      continue;
+    }
+    int status;
+    if (wait(&status) < 0) break;
+    running--;
+    done++;
+    if (done % 100 == 0 || done == n) fprintf(stderr, "\rtune: %zu/%zu", done, n);
+  }
+  while (running > 0 && wait(nullptr) > 0) running--;
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  fprintf(stderr, "\n");
+
+  // Pareto front over (delay, stops, max queue): after sorting by delay, a
+  // candidate is kept unless an earlier kept one dominates it
+  std::vector<size_t> order;
+  for (size_t i = 0; i < n; i++)
+    if (scores[i].ok) order.push_back(i);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    const TuneScore &x = scores[a], &y = scores[b];
+    if (x.delay != y.delay) return x.delay < y.delay;
+    if (x.stops != y.stops) return x.stops < y.stops;
+    return x.queue < y.queue;
+  });
+  std::vector<size_t> front;
+  for (size_t i : order) {
+    bool dominated = false;
+    for (size_t f : front)
+      if (dominates(scores[f], scores[i]) ||
+          (scores[f].delay == scores[i].delay && scores[f].stops == scores[i].stops &&
+           scores[f].queue == scores[i].queue)) {
+        dominated = true;
+        break;
+      }
+    if (!dominated) front.push_back(i);
+  }
+
+  printf("{\"candidates\":%zu,\"evaluated\":%zu,\"jobs\":%ld,\"wall_s\":%.1f,\"pareto\":[", n, order.size(), jobs,
+         wall);
+  for (size_t k = 0; k < front.size(); k++) {
+    const SimOptions &o = candidates[front[k]];
+    const TuneScore &s = scores[front[k]];
+    printf("%s\n  {", k ? "," : "");
+    for (const TuneRange &r : ranges) printf("\"%s\":%g,", r.param->name, r.param->get(o));
+    printf("\"avg_delay_s\":%.3f,\"stops_per_veh\":%.4f,\"max_queue\":%.0f,\"veh_per_hour\":%.1f}", s.delay,
+           s.stops, s.queue, s.vehPerHour);
+  }
+  printf("\n]}\n");
+  munmap(scores, n * sizeof(TuneScore));
+  return order.size() == n ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#pragma once
+// Host stand-in for the Arduino core's String, with the ESP32 core's memory
+// behaviour: up to 11 characters inline, longer text on the heap, and every
+// growth a realloc() to exactly the new length. Enough to measure what the
+// old String-built payloads cost (test/test_json); firmware code doesn't use it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+class String {
+ public:
+  String(const char *s = "") { copy(s, strlen(s)); }
+  String(const String &s) { copy(s.c_str(), s.length()); }
+  explicit String(int v) { format("%d", v); }
+  explicit String(unsigned int v) { format("%u", v); }
+  explicit String(long v) { format("%ld", v); }
+  explicit String(unsigned long v) { format("%lu", v); }
+  String(float v, unsigned int decimals = 2) { format("%.*f", decimals, (double)v); }
+  String(double v, unsigned int decimals = 2) { format("%.*f", decimals, v); }
+  ~String() {
+    if (heap) free(heap);
+  }
+
+  String &operator=(const String &s) {
+    if (this != &s) {
+      len = 0;
+      concat(s.c_str(), s.length());
+    }
+    return *this;
+  }
+  String &operator+=(const String &s) { return concat(s.c_str(), s.length()); }
+  String &operator+=(const char *s) { return concat(s, strlen(s)); }
+  String &operator+=(char c) { return concat(&c, 1); }
+
+  friend String operator+(const String &a, const String &b) {
+    String sum(a);
+    return sum += b;
+  }
+  friend String operator+(const String &a, const char *b) {
+    String sum(a);
+    return sum += b;
+  }
+  friend String operator+(const char *a, const String &b) {
+    String sum(a);
+    return sum += b;
+  }
+
+  const char *c_str() const { return heap ? heap : inline_; }
+  size_t length() const { return len; }
+
+ private:
+  static const size_t inlineSize = 12;
+
+  char inline_[inlineSize] = "";
+  char *heap = nullptr;
+  size_t len = 0, capacity = inlineSize - 1;
+
+  // Formatted into a stack buffer first, as the core's number constructors do
+  template <typename... Args>
+  void format(const char *fmt, Args... args) {
+    char buf[33];
+    int n = snprintf(buf, sizeof(buf), fmt, args...);
+    copy(buf, n < 0 ? 0 : (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+  }
+
+  void copy(const char *s, size_t n) {
+    len = 0;
+    concat(s, n);
+  }
+
+  String &concat(const char *s, size_t n) {
+    size_t need = len + n;
+    if (need > capacity) {
+      char *grown = (char *)realloc(heap, need + 1);
+      if (!grown) return *this;
+      if (!heap) memcpy(grown, inline_, len);
+      heap = grown;
+      capacity = need;
+    }
+    char *d = heap ? heap : inline_;
+    memmove(d + len, s, n);
+    len = need;
+    d[len] = 0;
+    return *this;
+  }
+};
@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in for the ESP32 WiFi library: the station is always connected,
+// and a WiFiClient is a plain TCP socket (Net.cpp)
+#include "Arduino.h"
+
+#define WL_CONNECTED 3
+
+class WiFiClass {
+ public:
+  int status() { return WL_CONNECTED; }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient {
+ public:
+  ~WiFiClient() { stop(); }
+  bool connected();  // open, and the peer hasn't closed it
+  void stop();
+
+  int fd = -1;
+};
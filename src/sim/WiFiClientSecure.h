@@ -0,0 +1,9 @@
+#pragma once
+// Host stand-in: no TLS, the settings are accepted and the connection is plain TCP
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setInsecure() {}
+  void setHandshakeTimeout(unsigned long) {}
+};
@@ -0,0 +1,88 @@
+// Discrete-time traffic simulator: runs the firmware's UltrasonicSensor() and
+// trafficController() against the virtual HAL and the stochastic lane model.
+//
+//   pio run -e sim && .pio/build/sim/program --hours 24 --profile rush
+//   .pio/build/sim/program --bench --baseline src/sim/baseline.json
+//   .pio/build/sim/program --corridor 3 --profile platoon --offset 0 --adapt
+#include "Arduino.h"
+#include "Sim.h"
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program [--hours H] [--seed N] [--tick-ms N] [--rates A,B,C,...]\n"
+          "               [--profile poisson|platoon|rush] [--min-green S] [--max-green S]\n"
+          "               [--overlap S] [--min-cycle S] [--max-cycle S] [--gap S] [--extension S]\n"
+          "               [--vehicles-per-count V]\n"
+          "               [--kp K] [--ki K] [--s-target S] [--deltamax D] [--noise CM] [--dropout P]\n"
+          "               [--preempt-every S] [--preempt-hold S] [--preempt-class emergency|transit]\n"
+          "               [--preempt-clearance S] [--record-trace FILE | --replay-trace FILE]\n"
+          "               [--lamp-log FILE] [--verbose] [--json]\n"
+          "               [--corridor N [--node I] [--port P] [--travel S] [--coord-cycle S]\n"
+          "                [--offset S] [--adapt] [--clock-skew MS]]\n"
+          "       program --bench [--baseline FILE] [--tolerance F] [--cpu-tolerance F]\n"
+          "       program --tune [--param NAME=LO:HI ...] [--grid STEPS | --candidates N] [--jobs J]\n"
+          "               [run options: traffic, --hours and settings not swept]\n"
+          "       program --decode-log SEGMENT...\n"
+          "       program --decode-status FILE...\n");
+}
+
+static bool hasFlag(int argc, char **argv, const char *flag) {
+  for (int i = 1; i < argc; i++)
+    if (!strcmp(argv[i], flag)) return true;
+  return false;
+}
+
+int main(int argc, char **argv) {
+  if (hasFlag(argc, argv, "--decode-log")) return runDecodeLog(argc, argv);
+  if (hasFlag(argc, argv, "--decode-status")) return runDecodeStatus(argc, argv);
+  SimOptions opt;
+  if (!parseSimArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (hasFlag(argc, argv, "--bench")) return runBench(argc, argv);
+  if (hasFlag(argc, argv, "--tune")) return runTune(argc, argv);
+  if (opt.nodes > 1 && opt.node < 0) return runCorridor(argc, argv);
+  simSerialEcho = hasFlag(argc, argv, "--verbose");
+
+  SimResult r = runSim(opt);
+  if (r.corridorFailed) return 1;
+
+  if (hasFlag(argc, argv, "--json")) {
+    printf("{\"avg_delay_s\":%.3f,\"veh_per_hour\":%.1f,\"stops_per_veh\":%.4f,\"max_queue\":%zu,"
+           "\"green_swing_s\":%.3f,\"cycles\":%lu,\"avg_cycle_s\":%.1f,"
+           "\"gap_outs\":%lu,\"max_outs\":%lu,\"lamp_changes\":%lu,\"lamp_violations\":%lu,"
+           "\"preemptions\":%lu,\"max_preempt_latency_s\":%.3f,\"avg_preempt_latency_s\":%.3f,\"lanes\":[",
+           r.avgDelay(), r.vehPerHour(), r.stopsPerVeh(), r.maxQueue(), r.greenSwing, r.cycles, r.avgCycle,
+           r.gapOuts, r.maxOuts, r.lampChanges, r.lampViolations, r.preemptions, r.maxPreemptLatency,
+           r.avgPreemptLatency);
+    for (int i = 0; i < APPROACHES; i++) {
+      const LaneMetrics &m = r.lanes[i];
+      printf("%s{\"arrived\":%lu,\"detected\":%lu,\"served\":%lu,\"avg_delay_s\":%.3f,\"stops\":%lu,\"max_queue\":%zu}",
+             i ? "," : "", m.arrivals, r.detected[i], m.departures,
+             m.departures ? m.totalDelay / m.departures : 0.0, m.stops, m.maxQueue);
+    }
+    printf("]}\n");
+    return r.lampViolations ? 1 : 0;
+  }
+
+  printf("lane  arrived  detected  served  avg_delay_s  stops  max_queue\n");
+  for (int i = 0; i < APPROACHES; i++) {
+    const LaneMetrics &m = r.lanes[i];
+    printf("%c     %7lu  %8lu  %6lu  %11.1f  %5lu  %9zu\n", 'A' + i, m.arrivals, r.detected[i],
+           m.departures, m.departures ? m.totalDelay / m.departures : 0.0, m.stops, m.maxQueue);
+  }
+  printf("simulated %.1f h in %.2f s (%.0fx real time), %lu cycles, avg cycle %.1f s\n", r.simSeconds / 3600,
+         r.wallSeconds, r.wallSeconds > 0 ? r.simSeconds / r.wallSeconds : 0.0, r.cycles, r.avgCycle);
+  printf("greens: %lu gapped out, %lu maxed out\n", r.gapOuts, r.maxOuts);
+  printf("lamps: %lu changes, %lu safety violations\n", r.lampChanges, r.lampViolations);
+  if (opt.preemptEvery > 0)
+    printf("priority: %lu requests served, request to target showing %.2f s worst, %.2f s mean\n", r.preemptions,
+           r.maxPreemptLatency, r.avgPreemptLatency);
+  printf("avg delay %.1f s/veh, %.0f veh/h served, %.2f stops/veh, green swing %.2f s/lane/cycle\n",
+         r.avgDelay(), r.vehPerHour(), r.stopsPerVeh(), r.greenSwing);
+  if (opt.nodes > 1)
+    printf("corridor node %d: offset %.0f s, %.0f%% of arrivals on green, %lu shifts, clock %s\n", opt.node,
+           r.offset, r.onGreen * 100, r.offsetShifts, r.synced ? "synced" : "free");
+  return r.lampViolations ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+// AdaptiveGreen on its own (separate state per instance, rate limit, rounding,
+// bounds, anti-windup) and as the controller's per-approach trim at each cycle end
+#include "Hal.h"
+#include "TrafficLight.h"
+#include <unity.h>
+
+static const AdaptiveParams params = {20, 0, 0.05, 5, 5, 60};
+
+void setUp() {}
+void tearDown() {}
+
+// Interleaved updates of two lanes give what each would get alone
+static void test_lanes_independent() {
+  AdaptiveGreen a(params), b(params), aloneA(params), aloneB(params);
+  unsigned long ga = 30, gb = 30, gAloneA = 30, gAloneB = 30;
+  for (int k = 0; k < 20; k++) {
+    float flowA = 0.4f + 0.01f * k, flowB = 0.05f;
+    ga = a.update(ga, flowA, 2);
+    gb = b.update(gb, flowB, 10);
+    gAloneA = aloneA.update(gAloneA, flowA, 2);
+    gAloneB = aloneB.update(gAloneB, flowB, 10);
+    TEST_ASSERT_EQUAL_UINT32(gAloneA, ga);
+    TEST_ASSERT_EQUAL_UINT32(gAloneB, gb);
+  }
+}
+
+static void test_rate_limit_and_bounds() {
+  AdaptiveGreen g(params);
+  TEST_ASSERT_EQUAL_UINT32(35, g.update(30, 10, 1));  // error 9.95: +deltamax only
+  TEST_ASSERT_EQUAL_UINT32(60, g.update(58, 10, 1));  // capped at maxGreen
+  g.reset();
+  TEST_ASSERT_EQUAL_UINT32(5, g.update(5, 0, 10));  // floored at minGreen
+}
+
+// Fractional changes round to the nearest second rather than towards zero
+static void test_rounds_fraction() {
+  AdaptiveParams p = params;
+  p.Kp = 1;
+  AdaptiveGreen g(p);
+  TEST_ASSERT_EQUAL_UINT32(31, g.update(30, 0.75f, 1));  // +0.7 s
+  g.reset();
+  g.params.Kp = 14;
+  TEST_ASSERT_EQUAL_UINT32(29, g.update(30, 0, 1));  // -0.7 s
+}
+
+// Pinned at maxGreen the integral holds, so the output leaves the bound on the
+// first update whose error turns negative
+static void test_anti_windup() {
+  AdaptiveParams p = params;
+  p.Kp = 0;
+  p.Ki = 10;
+  AdaptiveGreen g(p);
+  unsigned long green = 60;
+  for (int k = 0; k < 50; k++) green = g.update(green, 1, 1);
+  TEST_ASSERT_EQUAL_UINT32(60, green);
+  g.params.Kp = 100;
+  for (int k = 0; k < 10 && green == 60; k++) green = g.update(green, 0, 10);
+  TEST_ASSERT_LESS_THAN_UINT32(60, green);
+}
+
+class NullOutput : public SignalOutput {
+ public:
+  void begin(LampMask) override {}
+  void apply(LampMask, LampMask) override {}
+};
+
+// Lane A: a slow car every 6 s (flow/speed well over s_target); the others a
+// fast car every 15 s (well under), or like lane A with `allSlow`. Fixed-time,
+// so greens are as allocated.
+static Intersection<APPROACHES> run(float Kp, bool allSlow = false) {
+  simReset();
+  ControllerConfig config = {20, 5, Kp, 0, 0.05, 5, 5, 60, 40, 120, 0.5, 2, 0, 2, 1, 2};
+  Intersection<APPROACHES> x(phasePlan);
+  static NullOutput out;
+  x.attach(&out);
+  x.begin(config, millis());
+  SensorTotals totals[APPROACHES];
+  for (unsigned long ms = 100; ms <= 1800000; ms += 100) {
+    simAdvanceTo(ms * 1000ULL);
+    for (int i = 0; i < APPROACHES; i++) {
+      bool slow = i == 0 || allSlow;
+      if (ms % (slow ? 6000 : 15000)) continue;
+      totals[i].vehicles++;
+      totals[i].totalSpeed += slow ? 1 : 10;
+      totals[i].speedCount++;
+    }
+    x.service(totals, config);
+  }
+  return x;
+}
+
+static void test_trim_in_control_path() {
+  Intersection<APPROACHES> plain = run(0), trimmed = run(100);
+  char msg[96];
+  snprintf(msg, sizeof(msg), "lane A green %lus untrimmed, %lus trimmed; cycle %lus, %lus", plain.green[0],
+           trimmed.green[0], plain.cycle, trimmed.cycle);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_GREATER_THAN_UINT32(plain.green[0], trimmed.green[0]);
+  for (int i = 1; i < APPROACHES; i++)
+    if (plain.green[i] > 5) TEST_ASSERT_LESS_THAN_UINT32(plain.green[i], trimmed.green[i]);
+
+  // The cycle is the trimmed greens plus the clearances
+  unsigned long cycle = 0;
+  for (uint8_t s = 0; s < phasePlan.stepCount; s++)
+    cycle += phasePlan.steps[s].timing >= 0 ? trimmed.green[phasePlan.steps[s].timing] : 5;
+  TEST_ASSERT_EQUAL_UINT32(cycle, trimmed.cycle);
+}
+
+// Every lane trimmed up from a maxCycle-long split: the greens are scaled back
+// so the cycle stays at maxCycle
+static void test_trim_keeps_cycle_bounds() {
+  Intersection<APPROACHES> plain = run(0, true), trimmed = run(100, true);
+  TEST_ASSERT_EQUAL_UINT32(120, plain.cycle);
+  TEST_ASSERT_EQUAL_UINT32(120, trimmed.cycle);
+  unsigned long cycle = 0;
+  for (uint8_t s = 0; s < phasePlan.stepCount; s++)
+    cycle += phasePlan.steps[s].timing >= 0 ? trimmed.green[phasePlan.steps[s].timing] : 5;
+  TEST_ASSERT_EQUAL_UINT32(cycle, trimmed.cycle);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_lanes_independent);
+  RUN_TEST(test_rate_limit_and_bounds);
+  RUN_TEST(test_rounds_fraction);
+  RUN_TEST(test_anti_windup);
+  RUN_TEST(test_trim_in_control_path);
+  RUN_TEST(test_trim_keeps_cycle_bounds);
+  return UNITY_END();
+}
@@ -0,0 +1,88 @@
+// allocateGreens() against a bisection on the water level, on random weights,
+// bounds and budgets, plus the infeasible and all-zero cases
+#include "Allocate.h"
+#include <algorithm>
+#include <math.h>
+#include <random>
+#include <unity.h>
+
+// The rounded split must sum to the budget, stay in bounds and sit within 1 s
+// of the exact level found by bisection
+static bool checkAllocation(const float *w, size_t n, unsigned long budget, unsigned long lo,
+                            unsigned long hi, const unsigned long *out) {
+  unsigned long sum = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (out[i] < lo || out[i] > hi) return false;
+    sum += out[i];
+  }
+  if (sum != budget) return false;
+
+  double maxW = 0;
+  for (size_t i = 0; i < n; i++) maxW = std::max(maxW, (double)w[i]);
+  double floorW = maxW > 0 ? maxW * 1e-6 : 1;
+  double a = 0, b = 1e12;
+  for (int it = 0; it < 200; it++) {
+    double mid = (a + b) / 2, total = 0;
+    for (size_t i = 0; i < n; i++) total += std::min((double)hi, std::max((double)lo, mid * std::max((double)w[i], floorW)));
+    (total < budget ? a : b) = mid;
+  }
+  for (size_t i = 0; i < n; i++) {
+    double x = std::min((double)hi, std::max((double)lo, a * std::max((double)w[i], floorW)));
+    if (fabs(out[i] - x) >= 1.0 + 1e-6) return false;
+  }
+  return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_random_splits() {
+  std::mt19937 rng(7);
+  float w[maxAllocLanes];
+  unsigned long out[maxAllocLanes];
+  int checked = 0;
+  for (int c = 0; c < 20000; c++) {
+    size_t n = 1 + rng() % maxAllocLanes;
+    unsigned long lo = rng() % 10, hi = lo + 1 + rng() % 60;
+    unsigned long budget = n * lo + 1 + rng() % (n * (hi - lo));
+    for (size_t i = 0; i < n; i++) w[i] = (rng() % 5 == 0) ? 0 : (rng() % 10000) / 100.0f;
+    if (budget >= n * hi) continue;
+    TEST_ASSERT_TRUE(allocateGreens(w, n, budget, lo, hi, out));
+    if (!checkAllocation(w, n, budget, lo, hi, out)) {
+      char msg[80];
+      snprintf(msg, sizeof(msg), "wrong split for n=%zu budget=%lu [%lu,%lu]", n, budget, lo, hi);
+      TEST_FAIL_MESSAGE(msg);
+    }
+    checked++;
+  }
+  TEST_ASSERT_GREATER_THAN(15000, checked);
+}
+
+// No split fits: every lane at the bound that binds
+static void test_infeasible_budget() {
+  const float w[3] = {1, 2, 3};
+  unsigned long out[3];
+  TEST_ASSERT_FALSE(allocateGreens(w, 3, 10, 5, 60, out));
+  for (unsigned long g : out) TEST_ASSERT_EQUAL_UINT32(5, g);
+  TEST_ASSERT_FALSE(allocateGreens(w, 3, 200, 5, 60, out));
+  for (unsigned long g : out) TEST_ASSERT_EQUAL_UINT32(60, g);
+}
+
+// Without demand the budget is split evenly, remainder to the lower indices
+static void test_zero_weights_even() {
+  const float w[4] = {0, 0, 0, 0};
+  unsigned long out[4];
+  TEST_ASSERT_TRUE(allocateGreens(w, 4, 42, 5, 60, out));
+  TEST_ASSERT_EQUAL_UINT32(11, out[0]);
+  TEST_ASSERT_EQUAL_UINT32(11, out[1]);
+  TEST_ASSERT_EQUAL_UINT32(10, out[2]);
+  TEST_ASSERT_EQUAL_UINT32(10, out[3]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_random_splits);
+  RUN_TEST(test_infeasible_budget);
+  RUN_TEST(test_zero_weights_even);
+  return UNITY_END();
+}
@@ -0,0 +1,89 @@
+// Two Coordinators over an in-memory link, their clocks passing the 32-bit
+// millis() wrap: the cycle position runs on without a jump on either node,
+// and the follower keeps the clock keeper's cycle starts
+#include "Coordination.h"
+#include <deque>
+#include <stdlib.h>
+#include <string>
+#include <unity.h>
+
+// Datagrams between nodes 0 and 1, delivered on the next receive()
+class PairLink : public CoordLink {
+ public:
+  PairLink(std::deque<std::string> *inbox, std::deque<std::string> *peer) : inbox(inbox), peer(peer) {}
+  void send(uint8_t, const void *data, size_t len) override { peer->push_back(std::string((const char *)data, len)); }
+  size_t receive(void *buf, size_t size) override {
+    if (inbox->empty()) return 0;
+    std::string d = inbox->front();
+    inbox->pop_front();
+    size_t n = d.size() < size ? d.size() : size;
+    memcpy(buf, d.data(), n);
+    return n;
+  }
+
+ private:
+  std::deque<std::string> *inbox, *peer;
+};
+
+static const uint32_t cycleMs = 60000, offsetMs = 20000;
+static const uint32_t skew = 7000;  // node 1's clock ahead of node 0's
+
+void setUp() {}
+void tearDown() {}
+
+// Node 0's clock starts 5 min before the wrap; both nodes are serviced every
+// 10 ms for 10 min. Positions advance exactly with the clock, and node 1's
+// is node 0's less its offset, up to the clock sync's error.
+static void test_position_across_wrap() {
+  std::deque<std::string> to0, to1;
+  PairLink link0(&to0, &to1), link1(&to1, &to0);
+  Coordinator keeper, follower;
+  uint32_t start = 0u - 300000;
+  keeper.begin(CoordConfig{1, 0, 2, 0, cycleMs / 1000, 0, false}, &link0, start);
+  follower.begin(CoordConfig{1, 1, 2, 0, cycleMs / 1000, offsetMs / 1000, false}, &link1, start + skew);
+
+  uint32_t lastKeeper = 0, lastFollower = 0;
+  int checked = 0;
+  for (uint32_t t = 0; t <= 600000; t += 10) {
+    uint32_t now = start + t;
+    keeper.service(now);
+    follower.service(now + skew);
+    if (!follower.plan(now + skew).active) continue;
+
+    // Within the sync's error: half the round trip, all of it on the way out here
+    CoordStatus fs = follower.status(now + skew);
+    uint32_t k = keeper.status(now).position, f = fs.position;
+    long error = ((long)f - (long)((k + cycleMs - offsetMs) % cycleMs) + cycleMs + cycleMs / 2) % cycleMs - cycleMs / 2;
+    TEST_ASSERT_LESS_OR_EQUAL((long)fs.roundTrip / 2, labs(error));
+    if (checked++) {
+      TEST_ASSERT_EQUAL_UINT32((lastKeeper + 10) % cycleMs, k);
+      TEST_ASSERT_EQUAL_UINT32((lastFollower + 10) % cycleMs, f);
+    }
+    lastKeeper = k;
+    lastFollower = f;
+  }
+  TEST_ASSERT_GREATER_THAN(59000, checked);
+}
+
+// A cycle start reported by plan() is a whole number of cycles from the last
+// one before the wrap
+static void test_plan_across_wrap() {
+  std::deque<std::string> to0, to1;
+  PairLink link0(&to0, &to1);
+  Coordinator keeper;
+  uint32_t start = 0u - 90000;
+  keeper.begin(CoordConfig{1, 0, 2, 0, cycleMs / 1000, 0, false}, &link0, start);
+  keeper.service(start);
+  uint32_t before = keeper.plan(start + 80000).zeroAt;
+  keeper.service(start + 200000);
+  uint32_t after = keeper.plan(start + 200000).zeroAt;
+  TEST_ASSERT_EQUAL_UINT32(0, (after - before) % cycleMs);
+  TEST_ASSERT_EQUAL_UINT32(2 * cycleMs, after - before);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_position_across_wrap);
+  RUN_TEST(test_plan_across_wrap);
+  return UNITY_END();
+}
@@ -0,0 +1,80 @@
+// EventLog.cpp on the host LittleFS stand-in: batches land in the current
+// segment, and a segment that can't be opened at rotation is retried with the
+// next batch instead of ending the log
+#include "EventLog.h"
+#include "Hal.h"
+#include "Log.h"
+#include <LittleFS.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unity.h>
+
+static const int batchRecords = 42;  // as EventLog.cpp
+static char root[] = "/tmp/eventlogXXXXXX";
+
+static bool header(int i, LogSegmentHeader &h) {
+  char path[16];
+  eventLogSegment(i, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  return f && f.read((uint8_t *)&h, sizeof(h)) == sizeof(h) && h.magic == logMagic;
+}
+
+// One full batch, 1 s apart from the last
+static void logBatch() {
+  simAdvanceTo(simMicros() + 1000000);
+  for (int k = 0; k < batchRecords; k++) eventLog(LOG_DETECTION, k % 3, 800, k);
+  eventLogFlush();
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_batches_written() {
+  EventLogStats before = eventLogStats();
+  for (int b = 0; b < 3; b++) logBatch();
+  EventLogStats after = eventLogStats();
+  TEST_ASSERT_EQUAL_UINT32(3, after.writes - before.writes);
+  TEST_ASSERT_EQUAL_UINT32(0, after.lost);
+
+  LogSegmentHeader h;
+  TEST_ASSERT_TRUE(header(0, h));
+  TEST_ASSERT_EQUAL_UINT32(1, h.sequence);
+}
+
+// Segment 1 can't be opened (a directory stands in its place), so the batch
+// that rotates into it is lost; the next batch opens segment 2
+static void test_rotation_retried() {
+  char blocked[64];
+  snprintf(blocked, sizeof(blocked), "%s/log/1.bin", root);
+  TEST_ASSERT_EQUAL(0, mkdir(blocked, 0755));
+
+  EventLogStats before = eventLogStats();
+  LogStats logBefore = logStats();
+  while (eventLogStats().sequence == before.sequence) logBatch();
+  EventLogStats failed = eventLogStats();
+  TEST_ASSERT_EQUAL_UINT32(batchRecords, failed.lost - before.lost);
+  logFlush();
+  TEST_ASSERT_EQUAL_UINT32(1, logStats().written - logBefore.written);
+
+  logBatch();
+  EventLogStats after = eventLogStats();
+  TEST_ASSERT_EQUAL_UINT32(1, after.writes - failed.writes);
+  TEST_ASSERT_EQUAL_UINT32(failed.lost, after.lost);
+  LogSegmentHeader h;
+  TEST_ASSERT_TRUE(header(2, h));
+  TEST_ASSERT_EQUAL_UINT32(after.sequence, h.sequence);
+}
+
+int main() {
+  if (!mkdtemp(root) || !LittleFS.begin(false, root)) return 1;
+  eventLogBegin();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_batches_written);
+  RUN_TEST(test_rotation_retried);
+  int failures = UNITY_END();
+  char cleanup[64];
+  snprintf(cleanup, sizeof(cleanup), "rm -rf %s", root);
+  if (system(cleanup) != 0) failures++;
+  return failures;
+}
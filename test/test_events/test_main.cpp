@@ -0,0 +1,70 @@
+// EventStream fan-out: every frame reaches every live subscriber, and one that
+// closed or can't take a whole frame is dropped and counted
+#include "Arduino.h"
+#include "EventStream.h"
+#include <unity.h>
+
+// Stands in for a dashboard's socket: keeps the last frame it was sent
+struct SinkClient {
+  char last[512] = "";
+  size_t room = sizeof(last) - 1;  // bytes it accepts per write
+  bool open = true;
+  size_t write(const uint8_t *data, size_t len) {
+    size_t n = len < room ? len : room;
+    memcpy(last, data, n);
+    last[n] = 0;
+    return n;
+  }
+  bool connected() const { return open; }
+  void stop() { open = false; }
+};
+
+static const char json[] = "{\"lanes\":{\"laneA\":{\"count\":12,\"status\":\"green\"}}}";
+
+void setUp() {}
+void tearDown() {}
+
+static void test_every_subscriber_gets_every_frame() {
+  EventStream<SinkClient, 8> events;
+  for (int i = 0; i < 8; i++) TEST_ASSERT_TRUE(events.add(SinkClient()));
+  TEST_ASSERT_TRUE(events.full());
+  TEST_ASSERT_FALSE(events.add(SinkClient()));
+
+  for (int f = 0; f < 1000; f++) TEST_ASSERT_EQUAL(8, events.send(json, sizeof(json) - 1));
+  TEST_ASSERT_EQUAL_UINT32(1000, events.frames());
+  TEST_ASSERT_EQUAL_UINT32(0, events.dropped());
+}
+
+typedef EventStream<SinkClient, 1> OneStream;
+
+static void test_frame_format() {
+  char buf[128];
+  size_t n = OneStream::frame(buf, sizeof(buf), json, sizeof(json) - 1);
+  TEST_ASSERT_EQUAL(6 + sizeof(json) - 1 + 2, n);
+  TEST_ASSERT_EQUAL(0, memcmp(buf, "data: ", 6));
+  TEST_ASSERT_EQUAL(0, memcmp(buf + n - 2, "\n\n", 2));
+  TEST_ASSERT_EQUAL(0, OneStream::frame(buf, 16, json, sizeof(json) - 1));
+}
+
+// A short write would leave the subscriber mid-frame, so it goes
+static void test_slow_and_closed_dropped() {
+  EventStream<SinkClient, 4> events;
+  SinkClient slow, closed;
+  slow.room = 10;
+  closed.open = false;
+  events.add(SinkClient());
+  events.add(slow);
+  events.add(closed);
+  TEST_ASSERT_EQUAL(1, events.send(json, sizeof(json) - 1));
+  TEST_ASSERT_EQUAL(1, events.size());
+  TEST_ASSERT_EQUAL_UINT32(2, events.dropped());
+  TEST_ASSERT_EQUAL(1, events.heartbeat());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_subscriber_gets_every_frame);
+  RUN_TEST(test_frame_format);
+  RUN_TEST(test_slow_and_closed_dropped);
+  return UNITY_END();
+}
@@ -0,0 +1,57 @@
+// LatencyHistogram bucket placement and what record() accumulates
+#include "Histogram.h"
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+// Every time up to 2^25 us lands in the first bucket whose bound holds it
+static void test_bucket_bounds() {
+  for (uint32_t us = 0; us < (1u << 25); us += 1 + us / 4096) {
+    int b = LatencyHistogram::bucket(us);
+    uint32_t hi = LatencyHistogram::bound(b), lo = b ? LatencyHistogram::bound(b - 1) : 0;
+    bool last = b == LatencyHistogram::buckets - 1;
+    if ((b && us <= lo) || (!last && us > hi) || (last && us <= lo)) {
+      char msg[64];
+      snprintf(msg, sizeof(msg), "%u us in bucket %d (%u, %u]", us, b, lo, hi);
+      TEST_FAIL_MESSAGE(msg);
+    }
+  }
+  TEST_ASSERT_EQUAL(0, LatencyHistogram::bucket(0));
+  TEST_ASSERT_EQUAL(LatencyHistogram::buckets - 1, LatencyHistogram::bucket(UINT32_MAX));
+}
+
+// Bounds rise by at most 1.5x, so a time is never more than 50% under its bound
+static void test_bounds_within_half() {
+  for (int i = 3; i < LatencyHistogram::buckets - 1; i++) {
+    uint32_t lo = LatencyHistogram::bound(i - 1), hi = LatencyHistogram::bound(i);
+    TEST_ASSERT_TRUE(hi > lo);
+    TEST_ASSERT_TRUE(2 * hi <= 3 * lo);
+  }
+}
+
+static void test_record_totals() {
+  LatencyHistogram h;
+  const uint32_t times[] = {0, 1, 5, 5, 1000, 70000000};
+  uint64_t sum = 0;
+  for (uint32_t us : times) {
+    h.record(us);
+    sum += us;
+  }
+  TEST_ASSERT_EQUAL_UINT32(6, h.total);
+  TEST_ASSERT_TRUE(h.sumUs == sum);
+  TEST_ASSERT_EQUAL_UINT32(70000000, h.maxUs);
+  TEST_ASSERT_EQUAL_UINT32(2, h.counts[LatencyHistogram::bucket(5)]);
+  TEST_ASSERT_EQUAL_UINT32(1, h.counts[LatencyHistogram::buckets - 1]);
+  uint32_t counted = 0;
+  for (uint32_t c : h.counts) counted += c;
+  TEST_ASSERT_EQUAL_UINT32(h.total, counted);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bucket_bounds);
+  RUN_TEST(test_bounds_within_half);
+  RUN_TEST(test_record_totals);
+  return UNITY_END();
+}
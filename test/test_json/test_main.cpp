@@ -0,0 +1,215 @@
+// The /api/status document built the old way, by String concatenation, and
+// with JsonWriter: same bytes out, heap traffic and time per payload compared
+#include "Arduino.h"
+#include "JsonWriter.h"
+#include "TrafficLight.h"
+#include <chrono>
+#include <unity.h>
+
+// Every heap call in the process, counted while `counting` is set
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void __libc_free(void *);
+
+static bool counting = false;
+static unsigned long allocations = 0, allocatedBytes = 0;
+
+static void count(size_t bytes) {
+  if (!counting) return;
+  allocations++;
+  allocatedBytes += bytes;
+}
+
+extern "C" void *malloc(size_t n) {
+  count(n);
+  return __libc_malloc(n);
+}
+extern "C" void *realloc(void *p, size_t n) {
+  count(n);
+  return __libc_realloc(p, n);
+}
+extern "C" void *calloc(size_t n, size_t size) {
+  count(n * size);
+  return __libc_calloc(n, size);
+}
+extern "C" void free(void *p) {
+  __libc_free(p);
+}
+
+// Same fields as interface.cpp's PublicLane and status document
+struct Lane {
+  int count;
+  float flow, avgSpeed, queue, flow1m, flow5m, flow15m, speedStdDev;
+  unsigned long greenTime;
+  const char *status;
+};
+
+struct Status {
+  int currentStep;
+  unsigned long green[APPROACHES];
+  bool allRed;
+  unsigned long cycle;
+  const char *preempt;
+  uint8_t priorityPending;
+  Lane lanes[APPROACHES];
+};
+
+static Status sample() {
+  Status st = {};
+  st.currentStep = 2;
+  st.allRed = false;
+  st.cycle = 74;
+  st.preempt = "none";
+  st.priorityPending = 0;
+  for (int i = 0; i < APPROACHES; i++) {
+    st.green[i] = 18 + 7 * i;
+    st.lanes[i] = Lane{12 + i, 0.0833f * (i + 1), 8.4125f - i, 3.5f + i, 0.071f, 0.0652f, 0.0598f, 1.2374f,
+                       st.green[i], i == 1 ? "green" : "red"};
+  }
+  return st;
+}
+
+// "laneA", "greenB", ... as interface.cpp's laneKey()
+static void key(const char *prefix, int i, char *buf) {
+  sprintf(buf, "%s%c", prefix, 'A' + i);
+}
+
+// As /api/status was served before JsonWriter
+static String statusString(const Status &st) {
+  char name[8];
+  String j = "{";
+  j += "\"status\":{";
+  j += "\"currentStep\":" + String(st.currentStep) + ",";
+  for (int i = 0; i < APPROACHES; i++) {
+    key("green", i, name);
+    j += "\"" + String(name) + "\":" + String(st.green[i]) + ",";
+  }
+  j += "\"allRed\":" + String(st.allRed ? "true" : "false") + ",";
+  j += "\"cycle\":" + String(st.cycle) + ",";
+  j += "\"preempt\":\"" + String(st.preempt) + "\",";
+  j += "\"priorityPending\":" + String((unsigned int)st.priorityPending);
+  j += "},";
+  j += "\"lanes\":{";
+  for (int i = 0; i < APPROACHES; i++) {
+    const Lane &L = st.lanes[i];
+    key("lane", i, name);
+    String s = "{";
+    s += "\"count\":" + String(L.count) + ",";
+    s += "\"flow\":" + String(L.flow, 4) + ",";
+    s += "\"avgSpeed\":" + String(L.avgSpeed, 4) + ",";
+    s += "\"queue\":" + String(L.queue, 1) + ",";
+    s += "\"flow1m\":" + String(L.flow1m, 4) + ",";
+    s += "\"flow5m\":" + String(L.flow5m, 4) + ",";
+    s += "\"flow15m\":" + String(L.flow15m, 4) + ",";
+    s += "\"speedStdDev\":" + String(L.speedStdDev, 4) + ",";
+    s += "\"greenTime\":" + String(L.greenTime) + ",";
+    s += "\"status\":\"" + String(L.status) + "\"";
+    s += "}";
+    j += "\"" + String(name) + "\":" + s;
+    if (i < APPROACHES - 1) j += ",";
+  }
+  j += "}}";
+  return j;
+}
+
+// As interface.cpp's writeStatus()
+static void statusWriter(JsonWriter &w, const Status &st) {
+  char name[8];
+  w.beginObject();
+  w.key("status");
+  w.beginObject();
+  w.field("currentStep", st.currentStep);
+  for (int i = 0; i < APPROACHES; i++) {
+    key("green", i, name);
+    w.field(name, st.green[i]);
+  }
+  w.field("allRed", st.allRed);
+  w.field("cycle", st.cycle);
+  w.field("preempt", st.preempt);
+  w.field("priorityPending", st.priorityPending);
+  w.endObject();
+  w.key("lanes");
+  w.beginObject();
+  for (int i = 0; i < APPROACHES; i++) {
+    key("lane", i, name);
+    w.key(name);
+    w.beginObject();
+    writeFields(w, st.lanes[i],
+                jsonField("count", &Lane::count),
+                jsonField("flow", &Lane::flow, 4),
+                jsonField("avgSpeed", &Lane::avgSpeed, 4),
+                jsonField("queue", &Lane::queue, 1),
+                jsonField("flow1m", &Lane::flow1m, 4),
+                jsonField("flow5m", &Lane::flow5m, 4),
+                jsonField("flow15m", &Lane::flow15m, 4),
+                jsonField("speedStdDev", &Lane::speedStdDev, 4),
+                jsonField("greenTime", &Lane::greenTime),
+                jsonField("status", &Lane::status));
+    w.endObject();
+  }
+  w.endObject();
+  w.endObject();
+}
+
+struct Cost {
+  double allocations, bytes, us;  // per payload
+  size_t length;
+};
+
+static const int payloads = 20000;
+
+template <typename Fn>
+static Cost measure(Fn build) {
+  allocations = allocatedBytes = 0;
+  size_t length = 0;
+  auto start = std::chrono::steady_clock::now();
+  counting = true;
+  for (int i = 0; i < payloads; i++) length += build();
+  counting = false;
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  return Cost{(double)allocations / payloads, (double)allocatedBytes / payloads, us / payloads, length / payloads};
+}
+
+static void report(const char *name, const Cost &c) {
+  char msg[112];
+  snprintf(msg, sizeof(msg), "%-10s %5zu B payload  %6.1f allocations  %7.0f B allocated  %6.2f us per payload",
+           name, c.length, c.allocations, c.bytes, c.us);
+  TEST_MESSAGE(msg);
+}
+
+static const Status st = sample();
+
+void setUp() {}
+void tearDown() {}
+
+static void test_same_document() {
+  static char body[256 + 256 * APPROACHES];
+  JsonWriter w(body, sizeof(body));
+  statusWriter(w, st);
+  TEST_ASSERT_TRUE(w.ok());
+  TEST_ASSERT_EQUAL_STRING(statusString(st).c_str(), body);
+}
+
+static void test_allocations_and_time() {
+  static char body[256 + 256 * APPROACHES];
+  Cost string = measure([] { return statusString(st).length(); });
+  Cost writer = measure([] {
+    JsonWriter w(body, sizeof(body));
+    statusWriter(w, st);
+    return w.length();
+  });
+  report("String", string);
+  report("JsonWriter", writer);
+
+  TEST_ASSERT_EQUAL_UINT32(string.length, writer.length);
+  TEST_ASSERT_GREATER_THAN(0, (int)string.allocations);
+  TEST_ASSERT_EQUAL_UINT32(0, (uint32_t)writer.allocations);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_document);
+  RUN_TEST(test_allocations_and_time);
+  return UNITY_END();
+}
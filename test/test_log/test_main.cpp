@@ -0,0 +1,40 @@
+// The deferred serial log: records drained as the log task does arrive in
+// full, and a ring overrun is counted rather than blocking the caller
+#include "Arduino.h"
+#include "Log.h"
+#include <unity.h>
+
+void setUp() {
+  logFlush();
+}
+void tearDown() {}
+
+static void test_drained_batches_lose_nothing() {
+  const unsigned long records = 200000, batch = 32;
+  LogStats before = logStats();
+  for (unsigned long i = 0; i < records; i += batch) {
+    for (unsigned long j = 0; j < batch; j++)
+      logWrite(LOG_LEVEL_INFO, "Lane %c | Flow %.2f | Green: %lus", 'A', 0.25f, i + j);
+    logFlush();
+  }
+  LogStats after = logStats();
+  TEST_ASSERT_EQUAL_UINT32(0, after.dropped - before.dropped);
+  TEST_ASSERT_EQUAL_UINT32(records, after.written - before.written);
+}
+
+// The ring holds 64 records; the rest are dropped and counted
+static void test_overrun_counted() {
+  LogStats before = logStats();
+  for (int i = 0; i < 100; i++) logWrite(LOG_LEVEL_WARN, "burst %d", i);
+  logFlush();
+  LogStats after = logStats();
+  TEST_ASSERT_EQUAL_UINT32(36, after.dropped - before.dropped);
+  TEST_ASSERT_EQUAL_UINT32(64, after.written - before.written);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_drained_batches_lose_nothing);
+  RUN_TEST(test_overrun_counted);
+  return UNITY_END();
+}
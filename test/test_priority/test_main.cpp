@@ -0,0 +1,114 @@
+// The hold a priority request may ask for (/api/priority?hold=S), the
+// request queue's order, and a repeat while the controller serves it
+#include "Hal.h"
+#include "TrafficLight.h"
+#include <unity.h>
+
+void setUp() {}
+void tearDown() {}
+
+static void test_hold_accepted() {
+  unsigned long ms = 0;
+  TEST_ASSERT_TRUE(parsePriorityHold("1", ms));
+  TEST_ASSERT_EQUAL_UINT32(1000, ms);
+  TEST_ASSERT_TRUE(parsePriorityHold("30", ms));
+  TEST_ASSERT_EQUAL_UINT32(30000, ms);
+  TEST_ASSERT_TRUE(parsePriorityHold("600", ms));
+  TEST_ASSERT_EQUAL_UINT32(600000, ms);
+}
+
+static void test_hold_refused() {
+  static const char *const bad[] = {"", "0", "-5", "+5", " 5", "5 ", "5s", "abc", "1.5", "601",
+                                    "4294968", "99999999999999999999"};
+  for (const char *text : bad) {
+    unsigned long ms = 1234;
+    TEST_ASSERT_FALSE_MESSAGE(parsePriorityHold(text, ms), text);
+    TEST_ASSERT_EQUAL_UINT32(1234, ms);
+  }
+}
+
+static void test_queue_order() {
+  PriorityQueue q;
+  TEST_ASSERT_TRUE(q.add(PriorityRequest{PRIORITY_TRANSIT, 1, 100, 0}));
+  TEST_ASSERT_TRUE(q.add(PriorityRequest{PRIORITY_EMERGENCY, 2, 300, 0}));
+  TEST_ASSERT_TRUE(q.add(PriorityRequest{PRIORITY_EMERGENCY, 0, 200, 0}));
+  TEST_ASSERT_EQUAL(0, q.top()->lane);
+
+  // A repeat refreshes the hold and keeps its place
+  TEST_ASSERT_TRUE(q.add(PriorityRequest{PRIORITY_EMERGENCY, 0, 400, 5000}));
+  TEST_ASSERT_EQUAL(3, q.size());
+  TEST_ASSERT_EQUAL(0, q.top()->lane);
+  TEST_ASSERT_EQUAL_UINT32(5000, q.top()->holdMs);
+
+  TEST_ASSERT_TRUE(q.release(PRIORITY_EMERGENCY, 0));
+  TEST_ASSERT_EQUAL(2, q.top()->lane);
+  TEST_ASSERT_TRUE(q.release(PRIORITY_EMERGENCY, 2));
+  TEST_ASSERT_EQUAL(PRIORITY_TRANSIT, q.top()->cls);
+  TEST_ASSERT_FALSE(q.release(PRIORITY_EMERGENCY, 2));
+}
+
+class NullOutput : public SignalOutput {
+ public:
+  void begin(LampMask) override {}
+  void apply(LampMask, LampMask) override {}
+};
+
+// Runs the controller on the virtual clock until `untilMs`
+static void runTo(Intersection<APPROACHES> &x, const ControllerConfig &config, unsigned long untilMs) {
+  static SensorTotals totals[APPROACHES];
+  while (millis() < untilMs) {
+    simAdvanceTo((millis() + 100) * 1000ULL);
+    x.service(totals, config);
+  }
+}
+
+// Re-sent while its green shows, a request holds the green for the new hold
+// from then on, not for what was left of the first
+static void test_repeat_while_served_extends() {
+  simReset();
+  ControllerConfig config = {20, 5, 20, 0, 0.05f, 5, 5, 60, 40, 120, 0.5f, 2, 3, 2, 1.25f, 2};
+  Intersection<APPROACHES> x(phasePlan);
+  static NullOutput out;
+  x.attach(&out);
+  x.begin(config, millis());
+  runTo(x, config, 1000);
+
+  const int8_t lane = 1;
+  TEST_ASSERT_TRUE(x.request(PriorityRequest{PRIORITY_EMERGENCY, lane, millis(), 10000}));
+  TrafficStatus st;
+  for (int i = 0; i < 200; i++) {
+    runTo(x, config, millis() + 100);
+    x.summary(st);
+    if (st.preempt == PREEMPT_SERVE) break;
+  }
+  TEST_ASSERT_EQUAL(PREEMPT_SERVE, st.preempt);
+  unsigned long servedAt = millis();
+
+  runTo(x, config, servedAt + 8000);
+  TEST_ASSERT_TRUE(x.request(PriorityRequest{PRIORITY_EMERGENCY, lane, millis(), 10000}));
+  unsigned long repeatAt = millis();
+
+  // Past the first hold: still served
+  runTo(x, config, servedAt + 12000);
+  x.summary(st);
+  TEST_ASSERT_EQUAL(PREEMPT_SERVE, st.preempt);
+  TEST_ASSERT_EQUAL(ASPECT_GREEN, st.lanes[lane].aspect);
+  TEST_ASSERT_EQUAL(1, st.priorityPending);
+
+  // The second hold ends 10 s after the repeat
+  runTo(x, config, repeatAt + 9500);
+  x.summary(st);
+  TEST_ASSERT_EQUAL(1, st.priorityPending);
+  runTo(x, config, repeatAt + 10500);
+  x.summary(st);
+  TEST_ASSERT_EQUAL(0, st.priorityPending);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_hold_accepted);
+  RUN_TEST(test_hold_refused);
+  RUN_TEST(test_queue_order);
+  RUN_TEST(test_repeat_while_served_extends);
+  return UNITY_END();
+}
@@ -0,0 +1,28 @@
+// The --bench scenarios against src/sim/baseline.json, at the baseline's own
+// tolerance. The CPU timings are per machine and stay with --bench --baseline.
+#include "Sim.h"
+#include <string>
+#include <unity.h>
+
+static BenchMetrics metrics;
+
+// The baseline beside the sources, wherever the project is checked out
+static std::string baselinePath() {
+  std::string here = __FILE__;
+  size_t at = here.rfind("test/test_regression/");
+  return (at == std::string::npos ? std::string() : here.substr(0, at)) + "src/sim/baseline.json";
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_scenarios() {
+  TEST_ASSERT_TRUE_MESSAGE(benchScenarios(SimOptions(), metrics), "scenario run failed");
+  TEST_ASSERT_EQUAL(0, benchRegressions(metrics, baselinePath().c_str(), "scenarios.", -1));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_scenarios);
+  return UNITY_END();
+}
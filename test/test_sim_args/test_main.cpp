@@ -0,0 +1,63 @@
+// Every setting --tune can sweep is also a run flag (the tuner prints its
+// results under those names) and reaches the controller's configuration;
+// a sweep whose ranges hold no valid setting ends with an error
+#include "Sim.h"
+#include <unity.h>
+
+static bool parse(const char *flag, const char *value, SimOptions &o) {
+  char program[] = "program";
+  char *argv[] = {program, (char *)flag, (char *)value};
+  return parseSimArgs(3, argv, o);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_tunable_flags() {
+  SimOptions o;
+  TEST_ASSERT_TRUE(parse("--min-green", "7", o));
+  TEST_ASSERT_TRUE(parse("--max-green", "45", o));
+  TEST_ASSERT_TRUE(parse("--min-cycle", "50", o));
+  TEST_ASSERT_TRUE(parse("--max-cycle", "110", o));
+  TEST_ASSERT_TRUE(parse("--gap", "2.5", o));
+  TEST_ASSERT_TRUE(parse("--extension", "1.5", o));
+  TEST_ASSERT_TRUE(parse("--vehicles-per-count", "1.75", o));
+  TEST_ASSERT_TRUE(parse("--kp", "80", o));
+  TEST_ASSERT_TRUE(parse("--ki", "4", o));
+  TEST_ASSERT_TRUE(parse("--s-target", "0.08", o));
+  TEST_ASSERT_TRUE(parse("--deltamax", "3", o));
+
+  ControllerConfig c = controllerConfig(o);
+  TEST_ASSERT_EQUAL_UINT32(7, c.minGreen);
+  TEST_ASSERT_EQUAL_UINT32(45, c.maxGreen);
+  TEST_ASSERT_EQUAL_UINT32(50, c.minCycle);
+  TEST_ASSERT_EQUAL_UINT32(110, c.maxCycle);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 2.5, c.gap);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.5, c.extension);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.75, c.vehiclesPerCount);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 80, c.Kp);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 4, c.Ki);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.08, c.s_target);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 3, c.deltamax);
+}
+
+static void test_unknown_flag_refused() {
+  SimOptions o;
+  TEST_ASSERT_FALSE(parse("--vehicles-per-cnt", "2", o));
+}
+
+// A range with no valid point (min-green always above max-green) fails fast
+static void test_tune_without_valid_candidates() {
+  char program[] = "program", tune[] = "--tune", param[] = "--param", range[] = "min-green=70:80",
+       candidates[] = "--candidates", five[] = "5";
+  char *argv[] = {program, tune, param, range, candidates, five};
+  TEST_ASSERT_EQUAL(2, runTune(6, argv));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_tunable_flags);
+  RUN_TEST(test_unknown_flag_refused);
+  RUN_TEST(test_tune_without_valid_candidates);
+  return UNITY_END();
+}
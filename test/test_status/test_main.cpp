@@ -0,0 +1,97 @@
+// Compact status frames (StatusFormat.h): random lane values round-trip to
+// within one fixed-point step, and damaged frames are refused
+#include "Arduino.h"
+#include "StatusFormat.h"
+#include <math.h>
+#include <random>
+#include <unity.h>
+
+static const int lanes = 4;
+static const size_t frameSize = sizeof(StatusHeader) + lanes * sizeof(StatusLane);
+
+struct Sent {
+  unsigned count, green;
+  float flow, avgSpeed, queue, rate[3], speedStdDev;
+};
+
+static void encode(uint8_t *frame, uint32_t sequence, const Sent *sent) {
+  StatusHeader h = {statusMagic, statusVersion, sizeof(StatusHeader), sizeof(StatusLane), lanes,
+                    sequence, sequence * 100, (uint8_t)(sequence % 6), (uint8_t)(sequence % 2), 90};
+  memcpy(frame, &h, sizeof(h));
+  for (int i = 0; i < lanes; i++) {
+    const Sent &L = sent[i];
+    StatusLane l = {statusFixed(L.count, 1), statusFixed(L.green, 1), statusFixed(L.flow, statusRateScale),
+                    statusFixed(L.avgSpeed, statusSpeedScale), statusFixed(L.queue, statusQueueScale),
+                    {statusFixed(L.rate[0], statusRateScale), statusFixed(L.rate[1], statusRateScale),
+                     statusFixed(L.rate[2], statusRateScale)},
+                    statusFixed(L.speedStdDev, statusSpeedScale), (uint8_t)(i % 3), 0};
+    memcpy(frame + sizeof(h) + i * sizeof(l), &l, sizeof(l));
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_round_trip() {
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<float> unit(0, 1);
+  uint8_t frame[statusMaxFrame];
+  for (uint32_t f = 0; f < 1000; f++) {
+    Sent sent[lanes];
+    for (Sent &L : sent) {
+      L.count = rng() % 100;
+      L.green = rng() % 90;
+      L.flow = unit(rng) * 0.6f;
+      L.avgSpeed = unit(rng) * 20;
+      L.queue = unit(rng) * 40;
+      for (float &r : L.rate) r = unit(rng) * 0.6f;
+      L.speedStdDev = unit(rng) * 5;
+    }
+    encode(frame, f, sent);
+
+    StatusValues v;
+    TEST_ASSERT_EQUAL(frameSize, decodeStatus(frame, frameSize, v));
+    TEST_ASSERT_EQUAL_UINT32(f, v.sequence);
+    TEST_ASSERT_EQUAL_UINT32(f * 100, v.uptimeMs);
+    TEST_ASSERT_EQUAL(lanes, v.lanes);
+    TEST_ASSERT_EQUAL(f % 2, v.allRed);
+    for (int i = 0; i < lanes; i++) {
+      const Sent &L = sent[i];
+      const StatusLaneValues &d = v.lane[i];
+      TEST_ASSERT_EQUAL_UINT32(L.count, d.count);
+      TEST_ASSERT_EQUAL_UINT32(L.green, d.green);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f / statusRateScale, L.flow, d.flow);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f / statusSpeedScale, L.avgSpeed, d.avgSpeed);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f / statusQueueScale, L.queue, d.queue);
+      for (int w = 0; w < 3; w++) TEST_ASSERT_FLOAT_WITHIN(0.5f / statusRateScale, L.rate[w], d.rate[w]);
+      TEST_ASSERT_FLOAT_WITHIN(0.5f / statusSpeedScale, L.speedStdDev, d.speedStdDev);
+      TEST_ASSERT_EQUAL(i % 3, d.aspect);
+    }
+  }
+}
+
+static void test_damaged_frames_refused() {
+  Sent sent[lanes] = {};
+  uint8_t frame[statusMaxFrame];
+  StatusValues v;
+  encode(frame, 1, sent);
+  TEST_ASSERT_EQUAL(0, decodeStatus(frame, frameSize - 1, v));
+  TEST_ASSERT_EQUAL(0, decodeStatus(frame, sizeof(StatusHeader) - 1, v));
+  frame[0] ^= 1;
+  TEST_ASSERT_EQUAL(0, decodeStatus(frame, frameSize, v));
+}
+
+// Out-of-range values saturate rather than wrap
+static void test_fixed_point_saturates() {
+  TEST_ASSERT_EQUAL_UINT16(0, statusFixed(-3, statusSpeedScale));
+  TEST_ASSERT_EQUAL_UINT16(65535, statusFixed(1000, statusSpeedScale));
+  TEST_ASSERT_EQUAL_UINT16(1235, statusFixed(12.345f, statusSpeedScale));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_damaged_frames_refused);
+  RUN_TEST(test_fixed_point_saturates);
+  return UNITY_END();
+}
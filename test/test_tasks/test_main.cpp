@@ -0,0 +1,256 @@
+// The task channels (Snapshot.h) and the task graph (Tasks.cpp) on the
+// pthread shim in Rtos.h: writers and readers on real threads, as on the board,
+// with the virtual clock following real time while the task graph runs
+#include "Hal.h"
+#include "Rtos.h"
+#include "Snapshot.h"
+#include "Tasks.h"
+#include <atomic>
+#include <unity.h>
+
+static const uint32_t itemsPerProducer = 200000;
+
+// Spins the calling task until `done` or a few seconds pass
+static bool waitFor(const std::atomic<int> &done, int target) {
+  for (int ms = 0; ms < 10000; ms++) {
+    if (done.load() >= target) return true;
+    vTaskDelay(1);
+  }
+  return false;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Every word the same, so a copy that mixes two publishes shows
+struct Frame {
+  uint32_t words[1024];
+};
+
+static Snapshot<Frame> frames;
+static std::atomic<int> writerDone;
+
+static void frameWriter(void *) {
+  Frame f;
+  for (uint32_t k = 1; k <= itemsPerProducer; k++) {
+    for (uint32_t &w : f.words) w = k;
+    frames.publish(f);
+  }
+  writerDone = 1;
+  vTaskDelete(nullptr);
+}
+
+static void test_snapshot_never_torn() {
+  writerDone = 0;
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(frameWriter, "writer", 4096, nullptr, 2, nullptr, 0));
+  uint32_t last = 0, reads = 0, torn = 0, backwards = 0;
+  while (!writerDone.load() || last != itemsPerProducer) {
+    Frame f = frames.read();
+    for (uint32_t w : f.words)
+      if (w != f.words[0]) torn++;
+    if (f.words[0] < last) backwards++;
+    last = f.words[0];
+    reads++;
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, backwards);
+  TEST_ASSERT_EQUAL_UINT32(itemsPerProducer, frames.version());
+  TEST_ASSERT_GREATER_THAN(0, reads);
+}
+
+static SpscQueue<uint32_t, 64> spsc;
+static std::atomic<int> spscDone;
+
+static void spscProducer(void *) {
+  for (uint32_t i = 0; i < itemsPerProducer; i++)
+    while (!spsc.push(i)) sched_yield();
+  spscDone = 1;
+  vTaskDelete(nullptr);
+}
+
+static void test_spsc_in_order() {
+  spscDone = 0;
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(spscProducer, "producer", 4096, nullptr, 2, nullptr, 0));
+  uint32_t next = 0, outOfOrder = 0, item;
+  while (next < itemsPerProducer) {
+    if (!spsc.pop(item)) {
+      sched_yield();
+      continue;
+    }
+    if (item != next) outOfOrder++;
+    next = item + 1;
+  }
+  TEST_ASSERT_TRUE(waitFor(spscDone, 1));
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  TEST_ASSERT_FALSE(spsc.pop(item));
+}
+
+static const int producers = 4;
+static MpscQueue<uint32_t, 64> mpsc;
+static std::atomic<int> mpscDone;
+
+// Item: producer in the top byte, its sequence number below
+static void mpscProducer(void *arg) {
+  uint32_t p = (uint32_t)(uintptr_t)arg;
+  for (uint32_t i = 0; i < itemsPerProducer; i++)
+    while (!mpsc.push(p << 24 | i)) sched_yield();
+  mpscDone++;
+  vTaskDelete(nullptr);
+}
+
+static void test_mpsc_exactly_once() {
+  mpscDone = 0;
+  for (int p = 0; p < producers; p++)
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(mpscProducer, "producer", 4096, (void *)(uintptr_t)p, 1,
+                                                      nullptr, p % 2));
+  uint32_t next[producers] = {}, outOfOrder = 0, received = 0, item;
+  while (received < producers * itemsPerProducer) {
+    if (!mpsc.pop(item)) {
+      sched_yield();
+      continue;
+    }
+    uint32_t p = item >> 24, i = item & 0xffffff;
+    TEST_ASSERT_LESS_THAN(producers, p);
+    // Each producer's items arrive in its own order, none twice or skipped
+    if (i != next[p]) outOfOrder++;
+    next[p] = i + 1;
+    received++;
+  }
+  TEST_ASSERT_TRUE(waitFor(mpscDone, producers));
+  TEST_ASSERT_EQUAL_UINT32(0, outOfOrder);
+  for (int p = 0; p < producers; p++) TEST_ASSERT_EQUAL_UINT32(itemsPerProducer, next[p]);
+  TEST_ASSERT_FALSE(mpsc.pop(item));
+}
+
+// Lamps nowhere; the detectors replay a fixed count so no task touches GPIO
+class NullOutput : public SignalOutput {
+ public:
+  void begin(LampMask) override {}
+  void apply(LampMask, LampMask) override {}
+};
+
+// Moves the virtual clock along with the monotonic clock, so the tasks'
+// micros() and millis() advance as they would on the board
+static std::atomic<bool> clockRunning;
+
+static void clockDriver(void *) {
+  timespec t0, now, tick = {0, 100000};
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  uint64_t base = simMicros();
+  while (clockRunning.load()) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    simAdvanceTo(base + (uint64_t)(now.tv_sec - t0.tv_sec) * 1000000 + (now.tv_nsec - t0.tv_nsec) / 1000);
+    nanosleep(&tick, nullptr);
+  }
+  vTaskDelete(nullptr);
+}
+
+// Passes of one task on the virtual clock; marked by that task only
+struct Passes {
+  std::atomic<bool> counting{false};
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint64_t> firstUs{0}, lastUs{0}, worstGapUs{0};
+
+  void mark() {
+    if (!counting.load()) return;
+    uint64_t now = simMicros();
+    if (count.load() == 0) firstUs = now;
+    else if (now - lastUs > worstGapUs) worstGapUs = now - lastUs;
+    lastUs = now;
+    count++;
+  }
+  float meanPeriodMs() const { return count.load() > 1 ? (lastUs - firstUs) / 1000.0f / (count - 1) : 0; }
+};
+
+class HostHooks : public TaskHooks {
+ public:
+  std::atomic<int> sensorsAttached{0}, ticks{0}, networkPasses{0}, logPasses{0};
+  std::atomic<unsigned long> vehiclesSeen{0};
+  std::atomic<bool> allRedSeen{false};
+  Passes controller, sensor, network, log;
+
+  void attachSensors(UltrasonicState *, int count) override { sensorsAttached = count; }
+  bool replaying(UltrasonicState *sensors, const char *const *, int count) override {
+    sensor.mark();
+    for (int i = 0; i < count; i++) sensors[i].totals.vehicles = 7;
+    return true;
+  }
+  void controlled(const SensorFrame &frame, const TrafficStatus &status) override {
+    controller.mark();
+    vehiclesSeen = frame.lanes[0].vehicles;
+    if (status.allRed) allRedSeen = true;
+    ticks++;
+  }
+  void serviceNetwork() override {
+    network.mark();
+    networkPasses++;
+  }
+  void publish(const TrafficStatus &) override {}
+  void drainLog() override {
+    log.mark();
+    logPasses++;
+  }
+  CoordLink *coordinationLink() override { return nullptr; }
+};
+
+// Mean period on the virtual clock within [loMs, hiMs]
+static void assertPeriod(const char *task, const Passes &p, float loMs, float hiMs) {
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%s: %lu passes, mean period %.3f ms, worst gap %.3f ms", task,
+           (unsigned long)p.count.load(), p.meanPeriodMs(), p.worstGapUs.load() / 1000.0);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_GREATER_THAN_UINT32(10, p.count.load());
+  TEST_ASSERT_FLOAT_WITHIN((hiMs - loMs) / 2, (loMs + hiMs) / 2, p.meanPeriodMs());
+}
+
+static void test_task_graph() {
+  static NullOutput lamps;
+  static HostHooks hooks;
+  ControllerConfig config = {20, 5, 20, 0, 0.05f, 5, 5, 60, 40, 120, 0.5f, 2, 3, 2, 1.25f, 2};
+  CoordConfig alone = {};
+  clockRunning = true;
+  TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(clockDriver, "clock", 4096, nullptr, 4, nullptr, 1));
+  startTasks(config, alone, lamps, hooks);
+
+  // Both the controller and the sensor task keep publishing
+  uint32_t status = statusFrames.version(), sensors = sensorFrames.version();
+  TEST_ASSERT_TRUE(waitFor(hooks.ticks, 20));
+  TEST_ASSERT_EQUAL(APPROACHES, hooks.sensorsAttached.load());
+  TEST_ASSERT_TRUE(waitFor(hooks.networkPasses, 50));
+  TEST_ASSERT_TRUE(waitFor(hooks.logPasses, 2));
+  TEST_ASSERT_GREATER_THAN(status + 5, statusFrames.version());
+  TEST_ASSERT_GREATER_THAN(sensors + 5, sensorFrames.version());
+
+  // Sensor frames reach the controller, and a command comes back in the status
+  for (int ms = 0; ms < 2000 && hooks.vehiclesSeen.load() != 7; ms++) vTaskDelay(1);
+  TEST_ASSERT_EQUAL_UINT32(7, hooks.vehiclesSeen.load());
+  TEST_ASSERT_FALSE(statusFrames.read().allRed);
+  TEST_ASSERT_TRUE(sendCommand(Command{CMD_TOGGLE_ALL_RED, PriorityRequest{}}));
+  for (int ms = 0; ms < 2000 && !hooks.allRedSeen.load(); ms++) vTaskDelay(1);
+  TEST_ASSERT_TRUE(hooks.allRedSeen.load());
+  TEST_ASSERT_TRUE(statusFrames.read().allRed);
+
+  // Each task keeps its period for 2 s. The controller runs on vTaskDelayUntil,
+  // so its mean is the period and a late tick is made up by the next; the
+  // others sleep a period after their work.
+  Passes *all[] = {&hooks.controller, &hooks.sensor, &hooks.network, &hooks.log};
+  for (Passes *p : all) p->counting = true;
+  vTaskDelay(2000);
+  for (Passes *p : all) p->counting = false;
+  clockRunning = false;
+  assertPeriod("controller", hooks.controller, 4.9f, 5.1f);
+  assertPeriod("sensor", hooks.sensor, 0.95f, 2);
+  assertPeriod("network", hooks.network, 1.9f, 3);
+  assertPeriod("log", hooks.log, 19, 22);
+  // Controller latency: no tick came more than 20 ms after the one before was due
+  TEST_ASSERT_LESS_THAN_UINT32(5000 + 20000, (uint32_t)hooks.controller.worstGapUs.load());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_snapshot_never_torn);
+  RUN_TEST(test_spsc_in_order);
+  RUN_TEST(test_mpsc_exactly_once);
+  RUN_TEST(test_task_graph);  // leaves the tasks running, so last
+  return UNITY_END();
+}
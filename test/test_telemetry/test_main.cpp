@@ -0,0 +1,276 @@
+// Telemetry.cpp against a loopback HTTP server standing in for the database:
+// batching, keep-alive, failures kept for retry, drop-oldest and the timeouts
+#include "Arduino.h"
+#include "Hal.h"
+#include "Telemetry.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <unity.h>
+
+enum Reply { REPLY_OK, REPLY_ERROR, REPLY_STALL };
+
+struct Request {
+  std::string line, body;
+};
+
+// One connection at a time, requests answered in order as `reply` says
+class StandIn {
+ public:
+  std::atomic<Reply> reply{REPLY_OK};
+  std::atomic<int> connections{0};
+  uint16_t port = 0;
+
+  void start() {
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    TEST_ASSERT_EQUAL(0, bind(listener, (sockaddr *)&addr, len));
+    TEST_ASSERT_EQUAL(0, listen(listener, 4));
+    getsockname(listener, (sockaddr *)&addr, &len);
+    port = ntohs(addr.sin_port);
+    thread = std::thread([this] { serve(); });
+  }
+
+  void stop() {
+    stopping = true;
+    thread.join();
+    close(listener);
+  }
+
+  std::vector<Request> requests() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+  }
+
+ private:
+  void serve() {
+    while (!stopping) {
+      if (!readable(listener)) continue;
+      int fd = accept(listener, nullptr, nullptr);
+      if (fd < 0) continue;
+      connections++;
+      Request r;
+      while (readRequest(fd, r)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          received.push_back(r);
+        }
+        Reply now = reply;
+        if (now == REPLY_STALL) {
+          // Never answer; wait for the client to give up and close
+          char c;
+          while (!stopping && (!readable(fd) || recv(fd, &c, 1, 0) > 0)) {}
+          break;
+        }
+        const char *answer = now == REPLY_OK ? "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nnull"
+                                             : "HTTP/1.1 500 Internal Server Error\r\nContent-Length: 0\r\n\r\n";
+        send(fd, answer, strlen(answer), MSG_NOSIGNAL);
+      }
+      close(fd);
+    }
+  }
+
+  bool readable(int fd) {
+    pollfd p = {fd, POLLIN, 0};
+    return poll(&p, 1, 20) > 0;
+  }
+
+  // Headers, then Content-Length bytes of body; false once the client closes
+  bool readRequest(int fd, Request &r) {
+    std::string data;
+    char buf[1024];
+    size_t end;
+    while ((end = data.find("\r\n\r\n")) == std::string::npos) {
+      if (stopping) return false;
+      if (!readable(fd)) continue;
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) return false;
+      data.append(buf, n);
+    }
+    size_t length = 0, at = data.find("Content-Length: ");
+    if (at != std::string::npos && at < end) length = strtoul(data.c_str() + at + 16, nullptr, 10);
+    while (data.size() < end + 4 + length) {
+      if (!readable(fd)) continue;
+      ssize_t n = recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0) return false;
+      data.append(buf, n);
+    }
+    r.line = data.substr(0, data.find("\r\n"));
+    r.body = data.substr(end + 4, length);
+    return true;
+  }
+
+  int listener = -1;
+  std::thread thread;
+  std::atomic<bool> stopping{false};
+  std::mutex mutex;
+  std::vector<Request> received;
+};
+
+static StandIn server;
+
+// Past the flush interval on the virtual clock, then one flush
+static void flush() {
+  simAdvanceTo(simMicros() + 1000000);
+  telemetryFlush();
+}
+
+void setUp() {
+  server.reply = REPLY_OK;
+}
+
+void tearDown() {}
+
+static void test_coalesced_batch() {
+  TelemetryStats before = telemetryStats();
+  telemetryQueue("lanes/laneA", "{\"count\":1}");
+  telemetryQueue("lanes/laneB", "{\"count\":2}");
+  telemetryQueue("lanes/laneA", "{\"count\":3}");
+  flush();
+
+  TelemetryStats after = telemetryStats();
+  TEST_ASSERT_EQUAL_UINT32(1, after.coalesced - before.coalesced);
+  TEST_ASSERT_EQUAL_UINT32(1, after.batches - before.batches);
+  std::vector<Request> got = server.requests();
+  TEST_ASSERT_EQUAL(1, (int)got.size());
+  TEST_ASSERT_EQUAL_STRING("PATCH /.json HTTP/1.1", got[0].line.c_str());
+  TEST_ASSERT_EQUAL_STRING("{\"lanes/laneA\":{\"count\":3},\"lanes/laneB\":{\"count\":2}}", got[0].body.c_str());
+
+  // Nothing pending: no request
+  flush();
+  TEST_ASSERT_EQUAL(1, (int)server.requests().size());
+}
+
+static void test_connection_kept_alive() {
+  int connections = server.connections;
+  size_t sent = server.requests().size();
+  for (int i = 0; i < 3; i++) {
+    telemetryQueue("status", "{\"cycle\":60}");
+    flush();
+  }
+  TEST_ASSERT_EQUAL(sent + 3, server.requests().size());
+  TEST_ASSERT_EQUAL(connections, server.connections.load());
+}
+
+// A failed PATCH is counted as failed, not sent, and its entries go out next time
+static void test_failure_retried() {
+  TelemetryStats before = telemetryStats();
+  server.reply = REPLY_ERROR;
+  telemetryQueue("lanes/laneC", "{\"count\":4}");
+  flush();
+  TelemetryStats failed = telemetryStats();
+  TEST_ASSERT_EQUAL_UINT32(1, failed.failed - before.failed);
+  TEST_ASSERT_EQUAL_UINT32(0, failed.batches - before.batches);
+
+  server.reply = REPLY_OK;
+  flush();
+  TelemetryStats after = telemetryStats();
+  TEST_ASSERT_EQUAL_UINT32(1, after.batches - failed.batches);
+  TEST_ASSERT_EQUAL_UINT32(0, after.failed - failed.failed);
+  std::vector<Request> got = server.requests();
+  TEST_ASSERT_EQUAL_STRING(got[got.size() - 2].body.c_str(), got.back().body.c_str());
+}
+
+static void test_drop_oldest() {
+  TelemetryStats before = telemetryStats();
+  char path[16];
+  for (int i = 0; i < 17; i++) {
+    snprintf(path, sizeof(path), "node%d", i);
+    telemetryQueue(path, "1");
+  }
+  flush();
+  TEST_ASSERT_EQUAL_UINT32(1, telemetryStats().dropped - before.dropped);
+  std::string body = server.requests().back().body;
+  TEST_ASSERT_TRUE(body.find("\"node0\"") == std::string::npos);
+  TEST_ASSERT_TRUE(body.find("\"node1\":1") != std::string::npos);
+  TEST_ASSERT_TRUE(body.find("\"node16\":1") != std::string::npos);
+}
+
+// A server that takes the request and never answers holds the network task
+// for the response timeout (1.5 s), not longer
+static void test_stall_bounded() {
+  TelemetryStats before = telemetryStats();
+  server.reply = REPLY_STALL;
+  telemetryQueue("status", "{\"cycle\":90}");
+  auto start = std::chrono::steady_clock::now();
+  flush();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  char msg[64];
+  snprintf(msg, sizeof(msg), "stalled PATCH returned after %ld ms", ms);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_OR_EQUAL(2000, ms);
+  TEST_ASSERT_EQUAL_UINT32(1, telemetryStats().failed - before.failed);
+
+  // The next flush reconnects and delivers
+  server.reply = REPLY_OK;
+  int connections = server.connections;
+  flush();
+  TEST_ASSERT_EQUAL_UINT32(1, telemetryStats().batches - before.batches);
+  TEST_ASSERT_EQUAL(connections + 1, server.connections.load());
+}
+
+// A host that never completes the handshake: a listener nobody accepts on,
+// its backlog already full, so the kernel drops further SYNs. Bounded by the
+// connect timeout (1 s).
+static void test_connect_bounded() {
+  int full = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  TEST_ASSERT_EQUAL(0, bind(full, (sockaddr *)&addr, len));
+  TEST_ASSERT_EQUAL(0, listen(full, 0));
+  getsockname(full, (sockaddr *)&addr, &len);
+  int queued[2];
+  for (int &q : queued) {
+    q = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    connect(q, (sockaddr *)&addr, len);
+  }
+  usleep(100000);
+
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u", ntohs(addr.sin_port));
+  telemetryBegin(url);
+  TelemetryStats before = telemetryStats();
+  telemetryQueue("status", "{\"cycle\":120}");
+  auto start = std::chrono::steady_clock::now();
+  flush();
+  long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+  char msg[64];
+  snprintf(msg, sizeof(msg), "unanswered connect returned after %ld ms", ms);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_LESS_OR_EQUAL(1500, ms);
+  TEST_ASSERT_EQUAL_UINT32(1, telemetryStats().failed - before.failed);
+
+  for (int q : queued) close(q);
+  close(full);
+}
+
+int main() {
+  server.start();
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u", server.port);
+  telemetryBegin(url);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_coalesced_batch);
+  RUN_TEST(test_connection_kept_alive);
+  RUN_TEST(test_failure_retried);
+  RUN_TEST(test_drop_oldest);
+  RUN_TEST(test_stall_bounded);
+  RUN_TEST(test_connect_bounded);
+  int failures = UNITY_END();
+  server.stop();
+  return failures;
+}
@@ -0,0 +1,113 @@
+// UltrasonicSensor() against the virtual clock and GPIO (sim/Hal.h): an
+// HC-SR04 model answers each trigger pulse with an echo edge pair, and the
+// sensor loop runs every millisecond for three lanes
+#include "Arduino.h"
+#include "Hal.h"
+#include "Ultrasonic.h"
+#include <unity.h>
+
+static const int lanes = 3;
+static const char *const names[lanes] = {"U1", "U2", "U3"};
+static const int trigPins[lanes] = {5, 23, 27};  // as main.cpp
+static const int echoPins[lanes] = {32, 18, 34};
+static const uint64_t runUs = 20000000;   // 20 s
+static const uint64_t carFrom = 8000000;  // lane 0: one vehicle under the sensor for 1 s
+static const uint64_t carTo = 9000000;
+
+struct Run {
+  UltrasonicState sensors[lanes];
+  unsigned long triggers[lanes];
+  uint64_t worstCallUs, worstPassUs;  // virtual time spent inside UltrasonicSensor()
+};
+
+static Run run;
+
+// Lane 0: road at 400 cm, the car at 120 cm. Lane 1: road at 300 cm.
+// Lane 2: nothing comes back (38 ms echo, past the sensor's 30 ms timeout).
+static void onTrigger(uint8_t pin, uint64_t at, void *) {
+  for (int i = 0; i < lanes; i++) {
+    if (pin != trigPins[i]) continue;
+    run.triggers[i]++;
+    float d = i == 0 ? (at >= carFrom && at < carTo ? 120 : 400) : i == 1 ? 300 : -1;
+    uint64_t rise = at + 450;
+    uint64_t width = d < 0 ? 38000 : (uint64_t)(d * 58.3f);
+    simScheduleEdge(rise, echoPins[i], HIGH);
+    simScheduleEdge(rise + width, echoPins[i], LOW);
+  }
+}
+
+void setUp() {
+  static bool ran = false;
+  if (ran) return;
+  ran = true;
+  simReset();
+  simOnTrigger(onTrigger, nullptr);
+  for (uint64_t t = 0; t < runUs; t += 1000) {
+    simAdvanceTo(t);
+    uint64_t passStart = simMicros();
+    for (int i = 0; i < lanes; i++) {
+      uint64_t start = simMicros();
+      UltrasonicSensor(names[i], run.sensors[i], trigPins[i], echoPins[i]);
+      run.worstCallUs = max(run.worstCallUs, simMicros() - start);
+    }
+    run.worstPassUs = max(run.worstPassUs, simMicros() - passStart);
+  }
+}
+
+void tearDown() {}
+
+// No call waits for an echo: the only time spent is the 10 us trigger pulse,
+// and only one sensor pings per pass
+static void test_loop_latency_bounded() {
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, (uint32_t)run.worstCallUs);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, (uint32_t)run.worstPassUs);
+}
+
+// Each sensor keeps its 100 ms period, lost echoes included
+static void test_samples_every_sensor() {
+  for (int i = 0; i < lanes; i++) {
+    char msg[48];
+    snprintf(msg, sizeof(msg), "%s: %lu pings in 20 s", names[i], run.triggers[i]);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_UINT32_WITHIN(5, runUs / 100000, run.triggers[i]);
+  }
+}
+
+// Counted once; the entry lags the car by the 3-sample mean and the debounce
+static void test_counts_the_vehicle() {
+  TEST_ASSERT_EQUAL_UINT32(1, run.sensors[0].totals.vehicles);
+  TEST_ASSERT_EQUAL_UINT32(1, run.sensors[0].totals.arrivals);
+  TEST_ASSERT_UINT32_WITHIN(300, carFrom / 1000 + 150, run.sensors[0].entryTime);
+  TEST_ASSERT_EQUAL_UINT32(0, run.sensors[1].totals.vehicles);
+  TEST_ASSERT_EQUAL_UINT32(0, run.sensors[2].totals.vehicles);
+  TEST_ASSERT_FALSE(run.sensors[0].carPresence);
+}
+
+// The detection front-end on replayed echoes: an empty road at 400 cm with
+// +-2 cm noise and 5% lost echoes, and a vehicle at 150 cm every 30 samples
+static void test_replay_counts_vehicles() {
+  const long samples = 300000;
+  UltrasonicState state;
+  uint64_t t0 = simMicros();
+  uint32_t x = 12345;
+  for (long i = 0; i < samples; i++) {
+    simAdvanceTo(t0 + (uint64_t)i * 100000);
+    x = x * 1664525u + 1013904223u;
+    unsigned long echoUs = (i % 30 >= 22) ? 8746 : 23324;
+    echoUs += (long)(x >> 24) - 128;
+    if ((x >> 8) % 20 == 0) echoUs = 0;
+    UltrasonicReplay("replay", state, echoUs);
+  }
+  TEST_ASSERT_UINT32_WITHIN(samples / 30 / 10, samples / 30, state.totals.vehicles);
+  // At most the last vehicle still under the sensor
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(1, state.totals.entries - state.totals.vehicles);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_latency_bounded);
+  RUN_TEST(test_samples_every_sensor);
+  RUN_TEST(test_counts_the_vehicle);
+  RUN_TEST(test_replay_counts_vehicles);
+  return UNITY_END();
+}